@@ -47,6 +47,12 @@ static inline double pow(int x, double y) { return std::pow((double)x, y); }
 //
 // #define DEBUG_GLOBALS
 
+// Uncomment to compute line of sight with the original per-ray bit_vector
+// sweep instead of the bitboard backend. Both give identical results (the
+// "los" debug test checks this); the old one is kept for benchmarking.
+//
+// #define LOS_RAY_BITVECTORS
+
 //
 // Define 'UNIX' if the target OS is UNIX-like.
 // Unknown OSes are assumed to be here.
@@ -5,6 +5,14 @@
 #include "env.h"
 #include "losglobal.h"
 
+// cell_see_cell() is false for anything further than LOS_MAX_RANGE, so this
+// cheap test lets the near iterators skip most of a crowded level.
+static bool _in_los_range(const coord_def &center, const coord_def &p,
+                          los_type los)
+{
+    return los == LOS_NONE || (p - center).rdist() <= LOS_MAX_RANGE;
+}
+
 actor_near_iterator::actor_near_iterator(coord_def c, los_type los)
     : center(c), _los(los), viewer(nullptr), i(-1)
 {
@@ -54,7 +62,7 @@ actor_near_iterator actor_near_iterator::operator++(int)
 
 bool actor_near_iterator::valid(const actor* a) const
 {
-    if (!a || !a->alive())
+    if (!a || !a->alive() || !_in_los_range(center, a->pos(), _los))
         return false;
     if (viewer && !a->visible_to(viewer))
         return false;
@@ -63,8 +71,11 @@ bool actor_near_iterator::valid(const actor* a) const
 
 void actor_near_iterator::advance()
 {
+    // Only slots in env.mons_in_use can hold a live monster. The set is read
+    // afresh at each step, so monsters created or moved into range during
+    // the loop are still visited, as with a plain scan of env.mons.
     do
-         if (++i >= MAX_MONSTERS)
+         if ((i = env.mons_in_use.next(i + 1)) >= MAX_MONSTERS)
              return;
     while (!valid(**this));
 }
@@ -72,18 +83,16 @@ void actor_near_iterator::advance()
 //////////////////////////////////////////////////////////////////////////
 
 monster_near_iterator::monster_near_iterator(coord_def c, los_type los)
-    : center(c), _los(los), viewer(nullptr), i(0)
+    : center(c), _los(los), viewer(nullptr), i(-1)
 {
-    if (!valid(&env.mons[0]))
-        advance();
+    advance();
     begin_point = i;
 }
 
 monster_near_iterator::monster_near_iterator(const actor *a, los_type los)
-    : center(a->pos()), _los(los), viewer(a), i(0)
+    : center(a->pos()), _los(los), viewer(a), i(-1)
 {
-    if (!valid(&env.mons[0]))
-        advance();
+    advance();
     begin_point = i;
 }
 
@@ -144,7 +153,7 @@ monster_near_iterator monster_near_iterator::end()
 
 bool monster_near_iterator::valid(const monster* a) const
 {
-    if (!a || !a->alive())
+    if (!a || !a->alive() || !_in_los_range(center, a->pos(), _los))
         return false;
     if (viewer && !a->visible_to(viewer))
         return false;
@@ -153,8 +162,9 @@ bool monster_near_iterator::valid(const monster* a) const
 
 void monster_near_iterator::advance()
 {
+    // See actor_near_iterator::advance().
     do
-         if (++i >= MAX_MONSTERS)
+         if ((i = env.mons_in_use.next(i + 1)) >= MAX_MONSTERS)
              return;
     while (!valid(**this));
 }
@@ -162,10 +172,10 @@ void monster_near_iterator::advance()
 //////////////////////////////////////////////////////////////////////////
 
 monster_iterator::monster_iterator()
-    : i(0)
+    : i(env.mons_in_use.next(0))
 {
-    while (i < MAX_MONSTERS && !env.mons[i].alive())
-        i++;
+    if (i < MAX_MONSTERS && !env.mons[i].alive())
+        advance();
 }
 
 monster_iterator::operator bool() const
@@ -188,9 +198,7 @@ monster* monster_iterator::operator->() const
 
 monster_iterator& monster_iterator::operator++()
 {
-    while (++i < MAX_MONSTERS)
-        if (env.mons[i].alive())
-            break;
+    advance();
     return *this;
 }
 
@@ -201,10 +209,13 @@ monster_iterator monster_iterator::operator++(int)
     return copy;
 }
 
+// Only slots in env.mons_in_use can hold a live monster. Looking the next one
+// up afresh each time keeps this safe when monsters are created or die
+// mid-loop, just like a scan over env.mons.
 void monster_iterator::advance()
 {
     do
-         if (++i >= MAX_MONSTERS)
+         if ((i = env.mons_in_use.next(i + 1)) >= MAX_MONSTERS)
              return;
     while (!(*this)->alive());
 }
@@ -1134,21 +1134,50 @@ void bolt::affect_cell()
         affect_ground();
 }
 
-static void _undo_tracer(bolt &orig, bolt &copy)
+namespace
 {
+    // The parts of a bolt that firing it as a tracer changes, to be put back
+    // afterwards. Saving just these spares every tracer a copy of the whole
+    // bolt, with its strings, path and hit counts.
     // FIXME: we should have a better idea of what gets changed!
-    orig.target           = copy.target;
-    orig.source           = copy.source;
-    orig.aimed_at_spot    = copy.aimed_at_spot;
-    orig.aimed_at_feet    = copy.aimed_at_feet;
-    orig.extra_range_used = copy.extra_range_used;
-    orig.auto_hit         = copy.auto_hit;
-    orig.ray              = copy.ray;
-    orig.colour           = copy.colour;
-    orig.flavour          = copy.flavour;
-    orig.real_flavour     = copy.real_flavour;
-    orig.bounces          = copy.bounces;
-    orig.bounce_pos       = copy.bounce_pos;
+    struct tracer_undo
+    {
+        explicit tracer_undo(const bolt &b)
+            : target(b.target), source(b.source),
+              aimed_at_spot(b.aimed_at_spot), aimed_at_feet(b.aimed_at_feet),
+              extra_range_used(b.extra_range_used), auto_hit(b.auto_hit),
+              ray(b.ray), colour(b.colour), flavour(b.flavour),
+              real_flavour(b.real_flavour), bounces(b.bounces),
+              bounce_pos(b.bounce_pos)
+        {
+        }
+
+        void restore(bolt &b) const
+        {
+            b.target           = target;
+            b.source           = source;
+            b.aimed_at_spot    = aimed_at_spot;
+            b.aimed_at_feet    = aimed_at_feet;
+            b.extra_range_used = extra_range_used;
+            b.auto_hit         = auto_hit;
+            b.ray              = ray;
+            b.colour           = colour;
+            b.flavour          = flavour;
+            b.real_flavour     = real_flavour;
+            b.bounces          = bounces;
+            b.bounce_pos       = bounce_pos;
+        }
+
+        coord_def target, source;
+        bool aimed_at_spot, aimed_at_feet;
+        int extra_range_used;
+        bool auto_hit;
+        ray_def ray;
+        colour_t colour;
+        beam_type flavour, real_flavour;
+        int bounces;
+        coord_def bounce_pos;
+    };
 }
 
 // This saves some important things before calling fire().
@@ -1161,19 +1190,16 @@ void bolt::fire()
 
     if (is_tracer)
     {
-        bolt boltcopy = *this;
-        if (special_explosion != nullptr)
-            boltcopy.special_explosion = new bolt(*special_explosion);
+        const tracer_undo undo(*this);
+        const bool has_explosion = special_explosion != nullptr;
+        const tracer_undo explosion_undo(has_explosion ? *special_explosion
+                                                       : *this);
 
         do_fire();
 
-        if (special_explosion != nullptr)
-        {
-            _undo_tracer(*special_explosion, *boltcopy.special_explosion);
-            delete boltcopy.special_explosion;
-        }
-
-        _undo_tracer(*this, boltcopy);
+        if (has_explosion)
+            explosion_undo.restore(*special_explosion);
+        undo.restore(*this);
     }
     else
         do_fire();
@@ -0,0 +1,126 @@
+#include <cstdio>
+
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "coordit.h"
+#include "los.h"
+#include "losparam.h"
+
+namespace
+{
+    // Walls at scattered fixed spots, smoke on every seventh cell.
+    struct opacity_pattern : opacity_func
+    {
+        CLONE(opacity_pattern)
+
+        opacity_type operator()(const coord_def& p) const override
+        {
+            const int h = p.x * 31 + p.y * 17;
+            if (h % 11 == 0)
+                return OPC_OPAQUE;
+            if (h % 7 == 0)
+                return OPC_HALF;
+            return OPC_CLEAR;
+        }
+    };
+
+    vector<bool> visible_cells()
+    {
+        const opacity_pattern opc;
+        vector<bool> seen;
+        for (const coord_def center : { coord_def(20, 20), coord_def(41, 33) })
+        {
+            los_grid sh;
+            losight(sh, center, opc, circle_def(LOS_MAX_RANGE, C_SQUARE));
+            for (radius_iterator ri(center, LOS_MAX_RANGE, C_SQUARE); ri; ++ri)
+                seen.push_back(sh(*ri - center));
+        }
+        return seen;
+    }
+}
+
+TEST_CASE("LOS rays round-trip through the ray cache", "[single-file]")
+{
+    const string cache = "test_los.rays";
+
+    los_compute_rays();
+    const vector<bool> computed = visible_cells();
+    REQUIRE(los_save_rays(cache));
+
+    REQUIRE(los_load_rays(cache));
+    REQUIRE(visible_cells() == computed);
+
+    BENCHMARK("casting LOS rays")
+    {
+        los_compute_rays();
+    };
+
+    BENCHMARK("loading LOS rays from the cache")
+    {
+        return los_load_rays(cache);
+    };
+
+    remove(cache.c_str());
+    remove((cache + ".lk").c_str());
+}
+
+TEST_CASE("Corrupt LOS ray caches are rejected", "[single-file]")
+{
+    const string cache = "test_los_bad.rays";
+
+    FILE *fp = fopen(cache.c_str(), "wb");
+    REQUIRE(fp);
+    fputs("not a ray cache", fp);
+    fclose(fp);
+
+    REQUIRE_FALSE(los_load_rays(cache));
+
+    remove(cache.c_str());
+    remove((cache + ".lk").c_str());
+    los_compute_rays();
+}
+
+TEST_CASE("LOS ray caches with out-of-range rays are rejected",
+          "[single-file]")
+{
+    const string cache = "test_los_range.rays";
+
+    los_compute_rays();
+    REQUIRE(los_save_rays(cache));
+
+    FILE *fp = fopen(cache.c_str(), "rb");
+    REQUIRE(fp);
+    vector<unsigned char> data;
+    for (int c; (c = fgetc(fp)) != EOF;)
+        data.push_back(c);
+    fclose(fp);
+
+    // The file ends with the coordinate count and the coordinates, two ints
+    // each, and just before those is the last ray's start and length.
+    auto int_at = [&](size_t pos)
+    {
+        return data[pos] << 24 | data[pos + 1] << 16 | data[pos + 2] << 8
+               | data[pos + 3];
+    };
+    size_t count_pos = 0;
+    for (size_t n = 1; 8 * n + 12 <= data.size(); ++n)
+        if (int_at(data.size() - 8 * n - 4) == (int)n)
+            count_pos = data.size() - 8 * n - 4;
+    REQUIRE(count_pos);
+
+    // A start of -1 with a length of 2 sums to 1 in unsigned arithmetic.
+    const unsigned char bad_ray[] = { 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 2 };
+    copy(begin(bad_ray), end(bad_ray), data.begin() + count_pos - 8);
+    fp = fopen(cache.c_str(), "wb");
+    REQUIRE(fp);
+    fwrite(data.data(), 1, data.size(), fp);
+    fclose(fp);
+
+    REQUIRE_FALSE(los_load_rays(cache));
+
+    remove(cache.c_str());
+    remove((cache + ".lk").c_str());
+    los_compute_rays();
+}
@@ -0,0 +1,68 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "map-cell.h"
+#include "mon-util.h"
+
+TEST_CASE( "map_cell payloads are shared until changed", "[single-file]" ) {
+
+    init_monsters();
+
+    SECTION ("copies share the same monster") {
+        const size_t before = map_monster_pool::get().size();
+        map_cell a;
+        a.set_monster(monster_info(MONS_RAT, MONS_RAT));
+        map_cell b(a);
+        map_cell c;
+        c = b;
+
+        REQUIRE(b.monsterinfo() == a.monsterinfo());
+        REQUIRE(c.monsterinfo() == a.monsterinfo());
+        REQUIRE(map_monster_pool::get().size() == before + 1);
+
+        a.clear_monster();
+        b.clear_monster();
+        REQUIRE(c.monster() == MONS_RAT);
+        c.clear_monster();
+        REQUIRE(map_monster_pool::get().size() == before);
+    }
+
+    SECTION ("changing a shared payload copies it first") {
+        map_cell a;
+        a.set_monster(monster_info(MONS_RAT, MONS_RAT));
+        a.set_cloud(cloud_info(CLOUD_FIRE, 0, 3, 0, coord_def(1, 1),
+                               KILL_NONE));
+        map_cell b(a);
+
+        b.set_payload_pos(coord_def(5, 6));
+        REQUIRE(b.monsterinfo() != a.monsterinfo());
+        REQUIRE(b.monsterinfo()->pos == coord_def(5, 6));
+        REQUIRE(a.monsterinfo()->pos != coord_def(5, 6));
+        REQUIRE(b.cloudinfo()->pos == coord_def(5, 6));
+        REQUIRE(a.cloudinfo()->pos == coord_def(1, 1));
+    }
+
+    SECTION ("editing an item leaves copies alone") {
+        item_def item;
+        item.base_type = OBJ_GOLD;
+        item.quantity = 10;
+
+        map_cell a;
+        a.set_item(item, false);
+        const map_cell b(a);
+
+        a.edit_item()->quantity = 20;
+        REQUIRE(a.item()->quantity == 20);
+        REQUIRE(b.item()->quantity == 10);
+    }
+
+    SECTION ("freed slots are reused") {
+        map_cell a;
+        a.set_cloud(cloud_info());
+        const size_t used = map_cloud_pool::get().size();
+        for (int i = 0; i < 100; i++)
+            a.set_cloud(cloud_info());
+        REQUIRE(map_cloud_pool::get().size() == used);
+    }
+}
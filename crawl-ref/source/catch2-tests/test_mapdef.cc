@@ -0,0 +1,57 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "mapdef.h"
+
+TEST_CASE("map_def tag queries", "[single-file]")
+{
+    map_def map;
+    map.set_tags("uniq_test_altar  temple_overflow_2 no_monster_gen "
+                 "test_entry");
+
+    SECTION("has_tag matches whole tags only")
+    {
+        REQUIRE(map.has_tag("no_monster_gen"));
+        REQUIRE(map.has_tag("test_entry"));
+        REQUIRE_FALSE(map.has_tag("no_monster"));
+        REQUIRE_FALSE(map.has_tag("never_seen_anywhere_tag"));
+    }
+
+    SECTION("has_all_tags needs every tag")
+    {
+        REQUIRE(map.has_all_tags("temple_overflow_2 test_entry"));
+        REQUIRE_FALSE(map.has_all_tags("temple_overflow_2 dummy"));
+        REQUIRE_FALSE(map.has_all_tags(""));
+    }
+
+    SECTION("prefixes and suffixes")
+    {
+        REQUIRE(map.has_tag_prefix("temple_"));
+        REQUIRE(map.has_tag_prefix("uniq_"));
+        REQUIRE_FALSE(map.has_tag_prefix("chance_"));
+        REQUIRE(map.has_tag_suffix("entry"));
+        REQUIRE(map.has_tag_suffix("_gen"));
+        REQUIRE_FALSE(map.has_tag_suffix(""));
+
+        // Tags interned after a prefix was first asked about.
+        map.add_tags("chance_test_late");
+        REQUIRE(map.has_tag_prefix("chance_"));
+        REQUIRE(map.has_tag_prefix("chance_test_"));
+    }
+
+    SECTION("removing tags")
+    {
+        REQUIRE(map.remove_tags("test_entry not_a_tag"));
+        REQUIRE_FALSE(map.has_tag("test_entry"));
+        REQUIRE_FALSE(map.has_tag_suffix("entry"));
+        REQUIRE_FALSE(map.remove_tags("test_entry"));
+    }
+
+    SECTION("tags_string is sorted")
+    {
+        REQUIRE(map.tags_string()
+                == "no_monster_gen temple_overflow_2 test_entry "
+                   "uniq_test_altar");
+    }
+}
@@ -0,0 +1,176 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "package.h"
+#include "syscalls.h"
+
+TEST_CASE( "Chunks read back what was written", "[single-file]" ) {
+
+    // Mix the byte-at-a-time writes of marshalling with writes that fill
+    // or overflow the staging buffer.
+    vector<char> expected;
+    vector<plen_t> sizes = { 1, 1, 4, 2, CHUNK_BUFFER_SIZE - 3,
+                             CHUNK_BUFFER_SIZE, 7, 3 * CHUNK_BUFFER_SIZE + 5,
+                             1, 0, 12 };
+    for (size_t i = 0; i < sizes.size(); ++i)
+        for (plen_t j = 0; j < sizes[i]; ++j)
+            expected.push_back((char)(i * 31 + j * 7));
+
+    package save;
+    {
+        chunk_writer out(&save, "data");
+        size_t at = 0;
+        for (plen_t size : sizes)
+        {
+            out.write(&expected[at], size);
+            at += size;
+        }
+    }
+
+    SECTION ("one byte at a time") {
+        chunk_reader in(&save, "data");
+        vector<char> got;
+        char c;
+        while (in.read(&c, 1))
+            got.push_back(c);
+        REQUIRE(got == expected);
+    }
+
+    SECTION ("in pieces of every size") {
+        chunk_reader in(&save, "data");
+        vector<char> got(expected.size());
+        size_t at = 0;
+        for (plen_t size : sizes)
+        {
+            REQUIRE(in.read(&got[at], size) == size);
+            at += size;
+        }
+        char c;
+        REQUIRE(in.read(&c, 1) == 0);
+        REQUIRE(got == expected);
+    }
+
+    SECTION ("all at once") {
+        chunk_reader in(&save, "data");
+        vector<char> got;
+        in.read_all(got);
+        REQUIRE(got == expected);
+    }
+}
+
+TEST_CASE( "Queued chunks are written by a background commit",
+           "[single-file]" ) {
+
+    package save;
+    vector<unsigned char> first(100000, 'a'), second = { 'b', 'c' },
+                          replaced = { 'd' };
+    save.queue_chunk("first", first);
+    save.queue_chunk("second", replaced);
+    save.queue_chunk("second", second);
+    REQUIRE(first.empty());
+    save.commit_in_background();
+
+    // Any use of the package waits for the background save.
+    REQUIRE(save.has_chunk("first"));
+    REQUIRE(save.has_chunk("second"));
+
+    vector<char> got;
+    {
+        chunk_reader in(&save, "first");
+        in.read_all(got);
+    }
+    REQUIRE(got == vector<char>(100000, 'a'));
+
+    got.clear();
+    {
+        chunk_reader in(&save, "second");
+        in.read_all(got);
+    }
+    REQUIRE(got == vector<char>({ 'b', 'c' }));
+
+    SECTION ("chunks queued without a commit are written on next use") {
+        vector<unsigned char> third = { 'e' };
+        save.queue_chunk("third", third);
+        REQUIRE(save.has_chunk("third"));
+    }
+}
+
+TEST_CASE( "Chunks keep the codec they were written with", "[single-file]" ) {
+
+    const string filename = "test-package-codecs.tmp";
+    vector<char> data(50000);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = (char)(i % 251);
+
+    vector<save_codec> codecs = { CODEC_ZLIB };
+    if (save_codec_supported(CODEC_ZSTD))
+        codecs.push_back(CODEC_ZSTD);
+
+    {
+        package save(filename.c_str(), true, true);
+        for (save_codec codec : codecs)
+        {
+            save.set_codec(codec);
+            chunk_writer out(&save, save_codec_name(codec));
+            out.write(&data[0], data.size());
+        }
+    }
+
+    package save(filename.c_str(), false);
+    for (save_codec codec : codecs)
+    {
+        CAPTURE(save_codec_name(codec));
+        REQUIRE(save.get_chunk_codec(save_codec_name(codec)) == codec);
+
+        chunk_reader in(&save, save_codec_name(codec));
+        vector<char> got;
+        in.read_all(got);
+        REQUIRE(got == data);
+    }
+    save.abort();
+    unlink_u(filename.c_str());
+}
+
+TEST_CASE( "Readers see chunks written while others are reading",
+           "[single-file]" ) {
+
+    // A reader open across writes pins the file mapping it started with;
+    // readers made after the writes must still find the new blocks.
+    package save;
+    vector<char> old_data(70000, 'o'), new_data(70000, 'n');
+    {
+        chunk_writer out(&save, "old");
+        out.write(&old_data[0], old_data.size());
+    }
+
+    chunk_reader old_in(&save, "old");
+    vector<char> head(10);
+    REQUIRE(old_in.read(&head[0], head.size()) == head.size());
+    {
+        chunk_writer out(&save, "new");
+        out.write(&new_data[0], new_data.size());
+    }
+    {
+        chunk_reader in(&save, "new");
+        vector<char> got;
+        in.read_all(got);
+        REQUIRE(got == new_data);
+    }
+
+    vector<char> got = head;
+    old_in.read_all(got);
+    REQUIRE(got == old_data);
+
+    SECTION ("and once every reader is done") {
+        vector<char> more(100, 'm');
+        {
+            chunk_writer out(&save, "new");
+            out.write(&more[0], more.size());
+        }
+        chunk_reader in(&save, "new");
+        got.clear();
+        in.read_all(got);
+        REQUIRE(got == more);
+    }
+}
@@ -0,0 +1,77 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "pattern.h"
+
+static int _first_individual_match(const vector<text_pattern> &pats,
+                                   const string &s)
+{
+    for (size_t i = 0; i < pats.size(); ++i)
+        if (pats[i].matches(s))
+            return i;
+    return -1;
+}
+
+TEST_CASE( "pattern_set agrees with matching rules one by one",
+           "[single-file]" ) {
+
+    const vector<text_pattern> pats = {
+        text_pattern("You feel (a bit )?hungry"),
+        text_pattern("^The .* dies!$"),
+        text_pattern("(dies|is destroyed)"),
+        text_pattern("([a-z]+) \\1"),                // backreference
+        text_pattern("GHOST", true),
+        text_pattern(""),                            // never matches
+        text_pattern("(unbalanced"),                 // invalid
+        text_pattern("dies"),
+        text_pattern("(rat )?(?(1)is|dies)"),        // numbered condition
+    };
+    pattern_set set(pats);
+
+    const vector<string> messages = {
+        "You feel a bit hungry.",
+        "The rat dies!",
+        "The rat is destroyed.",
+        "the the",
+        "A ghost appears.",
+        "The ghost dies!",
+        "Nothing happens.",
+        "",
+    };
+
+    for (const string &msg : messages)
+    {
+        CAPTURE(msg);
+        const int expected = _first_individual_match(pats, msg);
+        CHECK(set.first_match(msg) == expected);
+
+        vector<size_t> expected_all;
+        for (size_t i = 0; i < pats.size(); ++i)
+            if (pats[i].matches(msg))
+                expected_all.push_back(i);
+        CHECK(set.all_matches(msg) == expected_all);
+    }
+
+    SECTION ("filters skip rules without trying them") {
+        auto not_first = [](size_t i) { return i != 1; };
+        CHECK(set.first_match("The rat dies!", not_first) == 2);
+        CHECK(set.first_match("The rat dies!", [](size_t i) { return i > 4; })
+              == 7);
+        CHECK(set.first_match("The rat dies!", [](size_t) { return false; })
+              == -1);
+    }
+
+    SECTION ("update rebuilds only when the list changes") {
+        vector<text_pattern> list = { text_pattern("foo") };
+        pattern_set s;
+        CHECK(s.first_match("foo") == -1);
+        s.update(list);
+        CHECK(s.first_match("a foo") == 0);
+        list.insert(list.begin(), text_pattern("a"));
+        s.update(list);
+        CHECK(s.first_match("a foo") == 0);
+        CHECK(s.first_match("foo") == 1);
+        CHECK(s.size() == 2);
+    }
+}
@@ -4,6 +4,8 @@
 
 #include "AppHdr.h"
 
+#include "env.h"
+#include "feature.h"
 #include "map-cell.h"
 #include "random.h"
 #include "tags.h"
@@ -245,3 +247,140 @@ TEST_CASE( "Basic marshalling/unmarshalling works correctly.", "[single-file]" )
         }
     }
 }
+
+namespace
+{
+    // A rock level with a small room whose map knowledge mixes plain cells
+    // with ones that also remember a colour, a trap and a cloud.
+    void fill_test_level()
+    {
+        init_show_table(); // Initializes indices for feat_is_trap.
+
+        env.grid.init(DNGN_ROCK_WALL);
+        for (int x = 0; x < GXM; ++x)
+            for (int y = 0; y < GYM; ++y)
+            {
+                env.pgrid[x][y] = FPROP_NONE;
+                env.map_knowledge[x][y].clear();
+            }
+
+        for (int x = 10; x <= 20; ++x)
+            for (int y = 10; y <= 15; ++y)
+            {
+                env.grid[x][y] = DNGN_FLOOR;
+                env.map_knowledge[x][y].flags = MAP_SEEN_FLAG;
+                env.map_knowledge[x][y].set_feature(DNGN_FLOOR);
+            }
+        env.grid[21][12] = DNGN_CLOSED_DOOR;
+        env.map_knowledge[21][12].flags = MAP_MAGIC_MAPPED_FLAG;
+        env.map_knowledge[21][12].set_feature(DNGN_CLOSED_DOOR);
+
+        env.grid[12][12] = DNGN_TRAP_ALARM;
+        env.map_knowledge[12][12].set_feature(DNGN_TRAP_ALARM, 0, TRAP_ALARM);
+        env.map_knowledge[14][12].set_feature(DNGN_FLOOR, LIGHTGREEN);
+        env.map_knowledge[16][13].set_cloud(
+            cloud_info(CLOUD_FIRE, RED, 5, 0, coord_def(16, 13), KILL_MISC));
+
+        env.pgrid[11][11] = FPROP_BLOODY;
+        env.pgrid[12][11] = FPROP_BLOODY | FPROP_NO_TELE_INTO;
+    }
+
+    struct saved_cell
+    {
+        dungeon_feature_type feat;
+        uint32_t pflags;
+        uint32_t map_flags;
+        dungeon_feature_type map_feat;
+        unsigned map_colour;
+        trap_type map_trap;
+        cloud_type map_cloud;
+        unsigned map_cloud_colour;
+    };
+
+    vector<saved_cell> snapshot_level()
+    {
+        vector<saved_cell> cells;
+        for (int x = 0; x < GXM; ++x)
+            for (int y = 0; y < GYM; ++y)
+            {
+                const map_cell &mc = env.map_knowledge[x][y];
+                cells.push_back({ env.grid[x][y], env.pgrid[x][y].flags,
+                                  mc.flags, mc.feat(), mc.feat_colour(),
+                                  mc.trap(), mc.cloud(), mc.cloud_colour() });
+            }
+        return cells;
+    }
+
+    void require_same_level(const vector<saved_cell> &expected)
+    {
+        const vector<saved_cell> actual = snapshot_level();
+        REQUIRE(actual.size() == expected.size());
+        for (size_t i = 0; i < actual.size(); ++i)
+        {
+            INFO("cell " << i / GYM << ", " << i % GYM);
+            REQUIRE(actual[i].feat == expected[i].feat);
+            REQUIRE(actual[i].pflags == expected[i].pflags);
+            REQUIRE(actual[i].map_flags == expected[i].map_flags);
+            REQUIRE(actual[i].map_feat == expected[i].map_feat);
+            REQUIRE(actual[i].map_colour == expected[i].map_colour);
+            REQUIRE(actual[i].map_trap == expected[i].map_trap);
+            REQUIRE(actual[i].map_cloud == expected[i].map_cloud);
+            REQUIRE(actual[i].map_cloud_colour == expected[i].map_cloud_colour);
+        }
+    }
+}
+
+TEST_CASE( "Level planes can be saved and loaded", "[single-file]" ) {
+
+    SECTION ("columnar level planes can be roundtripped") {
+        fill_test_level();
+        const vector<saved_cell> expected = snapshot_level();
+
+        vector<unsigned char> buf;
+        auto w = writer(&buf);
+        marshall_level_planes(w);
+
+        env.grid.init(DNGN_FLOOR);
+        for (int x = 0; x < GXM; ++x)
+            for (int y = 0; y < GYM; ++y)
+            {
+                env.pgrid[x][y] = FPROP_HIGHLIGHT;
+                env.map_knowledge[x][y].clear();
+            }
+
+        auto r = reader(buf, TAG_MINOR_COLUMNAR_LEVEL);
+        unmarshall_level_planes(r);
+
+        require_same_level(expected);
+        REQUIRE(r.valid() == false);
+    }
+
+#if TAG_MAJOR_VERSION == 34
+    SECTION ("levels saved a cell at a time can still be read") {
+        fill_test_level();
+        const vector<saved_cell> expected = snapshot_level();
+
+        // What _tag_construct_level wrote before TAG_MINOR_COLUMNAR_LEVEL.
+        vector<unsigned char> buf;
+        auto w = writer(&buf);
+        for (int x = 0; x < GXM; ++x)
+            for (int y = 0; y < GYM; ++y)
+            {
+                marshallByte(w, env.grid[x][y]);
+                marshallMapCell(w, env.map_knowledge[x][y]);
+                marshallInt(w, env.pgrid[x][y].flags);
+            }
+
+        env.grid.init(DNGN_FLOOR);
+        for (int x = 0; x < GXM; ++x)
+            for (int y = 0; y < GYM; ++y)
+                env.map_knowledge[x][y].clear();
+
+        auto r = reader(buf, TAG_MINOR_COLUMNAR_LEVEL - 1);
+        unmarshall_level_planes(r);
+
+        require_same_level(expected);
+        REQUIRE(r.valid() == false);
+    }
+#endif
+}
@@ -0,0 +1,86 @@
+#include <climits>
+
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#ifdef USE_TILE_WEB
+#include "tileweb.h"
+
+namespace
+{
+    // Roughly what _send_map() writes for a full redraw of every cell.
+    void write_full_map()
+    {
+        tiles.json_open_object();
+        tiles.json_write_string("msg", "map");
+        tiles.json_write_bool("clear", true);
+        tiles.json_open_array("cells");
+        for (int y = 0; y < GYM; y++)
+            for (int x = 0; x < GXM; x++)
+            {
+                tiles.json_open_object();
+                tiles.json_write_int("x", x);
+                tiles.json_write_int("y", y);
+                tiles.json_write_int("f", (x * y) % 200);
+                tiles.json_write_string("g", x % 3 ? "." : "#");
+                tiles.json_write_int("col", 7);
+                tiles.json_open_object("t");
+                tiles.json_write_name("fg");
+                tiles.write_tileidx(x * GYM + y);
+                tiles.json_write_name("bg");
+                tiles.write_tileidx((tileidx_t) x << 32 | y);
+                tiles.json_close_object(true);
+                tiles.json_close_object(true);
+            }
+        tiles.json_close_array(true);
+        tiles.json_close_object(true);
+    }
+}
+
+TEST_CASE("Webtiles JSON is written correctly", "[single-file]")
+{
+    tiles.json_open_object();
+    tiles.json_write_string("msg", "a\"b\\c\n\x01" "d\xc3\xa9");
+    tiles.json_write_int("min", INT_MIN);
+    tiles.json_write_int(string("n"), -42);
+    tiles.json_write_bool("b", true);
+    tiles.json_write_null("z");
+    tiles.json_open_array("a");
+    tiles.write_tileidx(tileidx_t{3} << 32 | 5);
+    tiles.json_write_comma();
+    tiles.write_tileidx(7);
+    tiles.json_close_array();
+    tiles.json_open_object("e");
+    tiles.json_close_object(true);
+    tiles.json_close_object();
+
+    REQUIRE(tiles.get_message() ==
+            "{\"msg\":\"a\\\"b\\\\c\\u000a\\u0001d\xc3\xa9\","
+            "\"min\":-2147483648,\"n\":-42,\"b\":true,\"z\":null,"
+            "\"a\":[[5,3],7]}");
+    tiles.finish_message();
+}
+
+TEST_CASE("Long webtiles messages are written whole", "[single-file]")
+{
+    const string text(10000, 'x');
+    tiles.write_message("\"%s\"", text.c_str());
+    REQUIRE(tiles.get_message() == "\"" + text + "\"");
+    tiles.finish_message();
+}
+
+TEST_CASE("Webtiles map messages", "[single-file]")
+{
+    write_full_map();
+    const size_t bytes = tiles.get_message().size();
+    tiles.finish_message();
+
+    // Divide by the mean time for bytes/sec.
+    BENCHMARK("writing a full map (" + to_string(bytes) + " bytes)")
+    {
+        write_full_map();
+        tiles.finish_message();
+    };
+}
+#endif
@@ -45,9 +45,85 @@
 #include "unwind.h"
 #include "xom.h"
 
+cloud_grid::cloud_grid() : m_count(0)
+{
+    m_index.init(-1);
+}
+
+cloud_struct *cloud_grid::find(const coord_def &p)
+{
+    if (!map_bounds(p))
+        return nullptr;
+    const short slot = m_index(p);
+    return slot < 0 ? nullptr : &m_slots[slot];
+}
+
+const cloud_struct *cloud_grid::find(const coord_def &p) const
+{
+    return const_cast<cloud_grid *>(this)->find(p);
+}
+
+cloud_struct &cloud_grid::operator[](const coord_def &p)
+{
+    ASSERT(map_bounds(p));
+    short &slot = m_index(p);
+    if (slot >= 0)
+        return m_slots[slot];
+
+    if (!m_free.empty())
+    {
+        slot = m_free.back();
+        m_free.pop_back();
+        m_slots[slot] = cloud_struct();
+        m_keys[slot] = p;
+    }
+    else
+    {
+        slot = m_slots.size();
+        m_slots.emplace_back();
+        m_keys.push_back(p);
+    }
+    ++m_count;
+    return m_slots[slot];
+}
+
+void cloud_grid::erase(const coord_def &p)
+{
+    if (!map_bounds(p))
+        return;
+    short &slot = m_index(p);
+    if (slot < 0)
+        return;
+
+    m_keys[slot] = coord_def(-1, -1);
+    m_free.push_back(slot);
+    slot = -1;
+    --m_count;
+}
+
+void cloud_grid::clear()
+{
+    m_index.init(-1);
+    m_slots.clear();
+    m_keys.clear();
+    m_free.clear();
+    m_count = 0;
+}
+
+vector<coord_def> cloud_grid::positions() const
+{
+    vector<coord_def> result;
+    result.reserve(m_count);
+    for (const coord_def &p : m_keys)
+        if (p.x >= 0)
+            result.push_back(p);
+    sort(result.begin(), result.end());
+    return result;
+}
+
 cloud_struct* cloud_at(coord_def pos)
 {
-    return map_find(env.cloud, pos);
+    return env.cloud.find(pos);
 }
 
 /// damage = base + random2avg(random, random/15 + 1)
@@ -595,14 +671,12 @@ static void _handle_spectral_cloud(const cloud_struct& cloud)
 
 void manage_clouds()
 {
-    // We can't iterate over env.cloud directly because _dissipate_cloud
-    // will remove this cloud and invalidate our iterator.
-    vector<cloud_struct *> cloud_ptrs;
-    for (auto& entry : env.cloud)
-        cloud_ptrs.push_back(&entry.second);
-
-    for (auto ptr : cloud_ptrs)
+    // Clouds may be removed or created as we go, so look each one up afresh.
+    for (const coord_def &pos : env.cloud.positions())
     {
+        cloud_struct* ptr = cloud_at(pos);
+        if (!ptr)
+            continue;
         cloud_struct& cloud = *ptr;
 
 #ifdef ASSERTS
@@ -652,13 +726,7 @@ void delete_cloud(coord_def p)
 
 void delete_all_clouds()
 {
-    // We can't iterate over env.cloud directly because delete_cloud
-    // will remove this cloud and invalidate our iterator.
-    vector<coord_def> cloud_locs;
-    for (auto& entry : env.cloud)
-        cloud_locs.push_back(entry.first);
-
-    for (auto pos : cloud_locs)
+    for (const coord_def &pos : env.cloud.positions())
         delete_cloud(pos);
 }
 
@@ -1742,15 +1810,12 @@ void remove_vortex_clouds(mid_t whose)
     // spell (excluding immobile and mindless casters).
     // XXX: this comment seems impossibly out of date? ^
 
-    // We can't iterate over env.cloud directly because delete_cloud
-    // will remove this cloud and invalidate our iterator.
-    vector<coord_def> vortices;
-    for (auto& entry : env.cloud)
-        if (entry.second.type == CLOUD_VORTEX && entry.second.source == whose)
-            vortices.push_back(entry.first);
-
-    for (auto pos : vortices)
-        delete_cloud(pos);
+    for (const coord_def &pos : env.cloud.positions())
+    {
+        const cloud_struct &cloud = *cloud_at(pos);
+        if (cloud.type == CLOUD_VORTEX && cloud.source == whose)
+            delete_cloud(pos);
+    }
 }
 
 static void _spread_cloud(coord_def pos, cloud_type type, int radius, int pow,
@@ -5,6 +5,11 @@
 
 #pragma once
 
+#include <deque>
+#include <vector>
+
+#include "fixedarray.h"
+
 struct cloud_struct
 {
     coord_def     pos;
@@ -39,6 +44,39 @@ struct cloud_struct
     static killer_type   whose_to_killer(kill_category whose);
 };
 
+/**
+ * The clouds on a level, looked up through a grid of slot numbers rather
+ * than a tree. A cloud keeps its slot, and its address, until it is erased;
+ * erased slots are reused.
+ */
+class cloud_grid
+{
+public:
+    cloud_grid();
+
+    cloud_struct *find(const coord_def &p);
+    const cloud_struct *find(const coord_def &p) const;
+    // Find the cloud at p, adding an empty one if there is none.
+    cloud_struct &operator[](const coord_def &p);
+    void erase(const coord_def &p);
+    void clear();
+
+    size_t size() const { return m_count; }
+    bool empty() const { return !m_count; }
+
+    // The positions of all clouds, in coord_def order. Iterate over these
+    // rather than the clouds, so that clouds may be added or removed as you
+    // go, and so that the order doesn't depend on slot reuse.
+    vector<coord_def> positions() const;
+
+private:
+    FixedArray<short, GXM, GYM> m_index; // slot of each cell's cloud, or -1
+    deque<cloud_struct> m_slots;         // deque, so slots never move
+    vector<coord_def> m_keys;            // cell of each slot; free: (-1,-1)
+    vector<short> m_free;
+    size_t m_count;
+};
+
 enum cloud_tile_variation
 {
     CTVARY_NONE,     ///< fixed tile (or special case)
@@ -8,6 +8,7 @@
 #include "dlua.h"
 #include "end.h"
 #include "files.h"
+#include "hiscores.h" // xlog_fields
 #include "libutil.h"
 #include "l-libs.h"
 #include "maybe-bool.h"
@@ -41,12 +42,11 @@ static string _get_persist_file();
 
 CLua::CLua(bool managed)
     : error(), managed_vm(managed), shutting_down(false),
-      throttle_unit_lines(50000),
-      throttle_sleep_ms(0), throttle_sleep_start(2),
-      throttle_sleep_end(800), n_throttle_sleeps(0), mixed_call_depth(0),
+      throttle_unit_lines(50000), mixed_call_depth(0),
       lua_call_depth(0), max_mixed_call_depth(8),
-      max_lua_call_depth(100), memory_used(0),
-      _state(nullptr), sourced_files(), uniqindex(0)
+      max_lua_call_depth(100), memory_used(0), profile(), call_name(),
+      call_start(0), call_budget_ms(0), _state(nullptr), sourced_files(),
+      uniqindex(0)
 {
 }
 
@@ -218,30 +218,87 @@ void CLua::set_error(int err, lua_State *ls)
     error = serr? serr : "<Unknown error>";
 }
 
-void CLua::init_throttle()
+// The CPU time budget for a top-level call to the named function, hook or
+// file, in milliseconds; 0 if it may run for as long as it likes.
+static double _call_budget_ms(const string &name)
 {
-    if (!managed_vm)
+    const map<string, int> &budgets = crawl_state.clua_max_time_ms;
+    auto budget = budgets.find(name);
+    if (budget == budgets.end())
+        budget = budgets.find("");
+    return budget == budgets.end() ? 0 : max(budget->second, 0);
+}
+
+void CLua::init_throttle(const char *name)
+{
+    if (!managed_vm || mixed_call_depth)
         return;
 
+    // Time every top-level call, so that the profile also covers games
+    // that aren't throttled.
+    call_name = name ? name : "(function)";
+    call_start = thread_cpu_ms();
+    call_budget_ms = 0;
+
     if (!crawl_state.throttle)
         return;
 
     if (throttle_unit_lines <= 0)
         throttle_unit_lines = 500;
 
-    if (throttle_sleep_start < 1)
-        throttle_sleep_start = 1;
+    call_budget_ms = _call_budget_ms(call_name);
+    lua_sethook(_state, _clua_throttle_hook,
+                LUA_MASKCOUNT, throttle_unit_lines);
+    crawl_state.lua_script_killed = false;
+}
+
+void CLua::finish_call()
+{
+    if (call_name.empty())
+        return;
+
+    const double ms = call_cpu_ms();
+    call_profile &prof = profile[call_name];
+    ++prof.calls;
+    prof.total_ms += ms;
+    prof.max_ms = max(prof.max_ms, ms);
+    call_name.clear();
+}
 
-    if (throttle_sleep_end < throttle_sleep_start)
-        throttle_sleep_end = throttle_sleep_start;
+// CPU time used so far by the current top-level call. Only this thread's
+// time counts, so a save being finished in the background isn't charged to
+// whatever script happens to run meanwhile.
+double CLua::call_cpu_ms() const
+{
+    return thread_cpu_ms() - call_start;
+}
 
-    if (!mixed_call_depth)
+vector<pair<string, CLua::call_profile>> CLua::sorted_profile() const
+{
+    vector<pair<string, call_profile>> funcs(profile.begin(), profile.end());
+    sort(funcs.begin(), funcs.end(),
+         [](const pair<string, call_profile> &a,
+            const pair<string, call_profile> &b)
+         {
+             return a.second.total_ms > b.second.total_ms;
+         });
+    return funcs;
+}
+
+// Write one xlog-style line per profiled function, most expensive first.
+void CLua::dump_profile(FILE *out, const string &player) const
+{
+    for (const auto &func : sorted_profile())
     {
-        lua_sethook(_state, _clua_throttle_hook,
-                    LUA_MASKCOUNT, throttle_unit_lines);
-        throttle_sleep_ms = 0;
-        n_throttle_sleeps = 0;
-        crawl_state.lua_script_killed = false;
+        xlog_fields fields;
+        fields.add_field("v", "%s", Version::Short);
+        fields.add_field("name", "%s", player.c_str());
+        fields.add_field("fn", "%s", func.first.c_str());
+        fields.add_field("calls", "%u", func.second.calls);
+        fields.add_field("ms", "%.3f", func.second.total_ms);
+        fields.add_field("maxms", "%.3f", func.second.max_ms);
+        fields.add_field("killed", "%u", func.second.kills);
+        fprintf(out, "%s\n", fields.xlog_line().c_str());
     }
 }
 
@@ -264,7 +321,7 @@ int CLua::execstring(const char *s, const char *context, int nresults)
         return err;
 
     lua_State *ls = state();
-    lua_call_throttle strangler(this);
+    lua_call_throttle strangler(this, context);
     err = lua_pcall(ls, 0, nresults, 0);
     set_error(err, ls);
     return err;
@@ -321,7 +378,7 @@ int CLua::execfile(const char *filename, bool trusted, bool die_on_fail,
 
     lua_State *ls = state();
     int err = loadfile(ls, filename, trusted || !managed_vm, die_on_fail);
-    lua_call_throttle strangler(this);
+    lua_call_throttle strangler(this, filename);
     if (!err)
         err = lua_pcall(ls, 0, 0, 0);
     if (!err)
@@ -362,7 +419,7 @@ bool CLua::runhook(const char *hook, const char *params, ...)
         // So what's on top *is* a function. Call it with the args we have.
         va_list args;
         va_start(args, params);
-        calltopfn(ls, params, args);
+        calltopfn(ls, hook, params, args);
         va_end(args);
     }
     return true;
@@ -528,14 +585,14 @@ int CLua::return_count(lua_State *ls, const char *format)
     return 0;
 }
 
-bool CLua::calltopfn(lua_State *ls, const char *params, va_list args,
-                     int retc, va_list *copyto)
+bool CLua::calltopfn(lua_State *ls, const char *fn, const char *params,
+                     va_list args, int retc, va_list *copyto)
 {
     // We guarantee to remove the function from the stack
     int argc = push_args(ls, params, args, copyto);
     if (retc == -1)
         retc = return_count(ls, params);
-    lua_call_throttle strangler(this);
+    lua_call_throttle strangler(this, fn);
     int err = lua_pcall(ls, argc, retc, 0);
     set_error(err, ls);
     return !err;
@@ -555,7 +612,7 @@ maybe_bool CLua::callmbooleanfn(const char *fn, const char *params,
     if (!lua_isfunction(ls, -1))
         return maybe_bool::maybe;
 
-    bool ret = calltopfn(ls, params, args, 1);
+    bool ret = calltopfn(ls, fn, params, args, 1);
     if (!ret)
         return maybe_bool::maybe;
 
@@ -584,7 +641,7 @@ maybe_bool CLua::callmaybefn(const char *fn, const char *params, va_list args)
     if (!lua_isfunction(ls, -1))
         return maybe_bool::maybe;
 
-    bool ret = calltopfn(ls, params, args, 1);
+    bool ret = calltopfn(ls, fn, params, args, 1);
     if (!ret || !lua_isboolean(ls, -1))
         return maybe_bool::maybe;
 
@@ -672,7 +729,7 @@ bool CLua::callfn(const char *fn, const char *params, ...)
     va_list fnret;
     va_start(args, params);
 
-    bool ret = calltopfn(ls, params, args, -1, &fnret);
+    bool ret = calltopfn(ls, fn, params, args, -1, &fnret);
     if (ret)
     {
         // If we have a > in format, gather return params now.
@@ -706,7 +763,7 @@ bool CLua::callfn(const char *fn, int nargs, int nret)
             lua_insert(ls, -nargs - 1);
     }
 
-    lua_call_throttle strangler(this);
+    lua_call_throttle strangler(this, fn);
     int err = lua_pcall(ls, nargs, nret, 0);
     set_error(err, ls);
     return !err;
@@ -1134,31 +1191,22 @@ static void _clua_throttle_hook(lua_State *ls, lua_Debug *dbg)
     if (!lua)
         lua = &clua;
 
-    if (lua)
+    // Kill the script once its top-level call has used up its CPU budget.
+    // Scripts that catch the error with pcall are killed again at the next
+    // check.
+    if (lua->call_budget_ms > 0 && lua->call_cpu_ms() > lua->call_budget_ms)
     {
-        if (!lua->throttle_sleep_ms)
-            lua->throttle_sleep_ms = lua->throttle_sleep_start;
-        else if (lua->throttle_sleep_ms < lua->throttle_sleep_end)
-            lua->throttle_sleep_ms *= 2;
-
-        ++lua->n_throttle_sleeps;
-
-        delay(lua->throttle_sleep_ms);
-
-        // Try to kill the annoying script.
-        if (lua->n_throttle_sleeps > CLua::MAX_THROTTLE_SLEEPS)
-        {
-            lua->n_throttle_sleeps = CLua::MAX_THROTTLE_SLEEPS;
-            crawl_state.lua_script_killed = true;
-            luaL_error(ls, BUGGY_SCRIPT_ERROR);
-        }
+        if (!crawl_state.lua_script_killed)
+            ++lua->profile[lua->call_name].kills;
+        crawl_state.lua_script_killed = true;
+        luaL_error(ls, BUGGY_SCRIPT_ERROR);
     }
 }
 
-lua_call_throttle::lua_call_throttle(CLua *_lua)
+lua_call_throttle::lua_call_throttle(CLua *_lua, const char *name)
     : lua(_lua)
 {
-    lua->init_throttle();
+    lua->init_throttle(name);
     if (!lua->mixed_call_depth++)
         lua_map[lua->state()] = lua;
 }
@@ -1166,7 +1214,10 @@ lua_call_throttle::lua_call_throttle(CLua *_lua)
 lua_call_throttle::~lua_call_throttle()
 {
     if (!--lua->mixed_call_depth)
+    {
+        lua->finish_call();
         lua_map.erase(lua->state());
+    }
 }
 
 CLua *lua_call_throttle::find_clua(lua_State *ls)
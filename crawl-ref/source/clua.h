@@ -32,7 +32,7 @@ private:
 class lua_call_throttle
 {
 public:
-    lua_call_throttle(CLua *handle);
+    lua_call_throttle(CLua *handle, const char *name = nullptr);
     ~lua_call_throttle();
 
     static CLua *find_clua(lua_State *ls);
@@ -150,6 +150,9 @@ public:
     /* Add the libraries and globals currently used by clua and dlua */
     void init_libraries();
 
+    double call_cpu_ms() const;
+    void dump_profile(FILE *out, const string &player) const;
+
 public:
     string error;
 
@@ -158,9 +161,6 @@ public:
     bool managed_vm;
     bool shutting_down;
     int throttle_unit_lines;
-    int throttle_sleep_ms;
-    int throttle_sleep_start, throttle_sleep_end;
-    int n_throttle_sleeps;
     int mixed_call_depth;
     int lua_call_depth;
     int max_mixed_call_depth;
@@ -168,7 +168,25 @@ public:
 
     long memory_used;
 
-    static const int MAX_THROTTLE_SLEEPS = 15;
+    // CPU time used by top-level calls into a managed VM, by the name of
+    // the function, hook or file that was called.
+    struct call_profile
+    {
+        call_profile() : calls(0), kills(0), total_ms(0), max_ms(0) { }
+
+        unsigned int calls;
+        unsigned int kills;
+        double total_ms;
+        double max_ms;
+    };
+    map<string, call_profile> profile;
+    // The profile, most expensive first.
+    vector<pair<string, call_profile>> sorted_profile() const;
+
+    // The top-level call being timed, if any.
+    string call_name;
+    double call_start;
+    double call_budget_ms;
 
 private:
     lua_State *_state;
@@ -181,7 +199,8 @@ private:
 private:
     void init_lua();
     void set_error(int err, lua_State *ls = nullptr);
-    void init_throttle();
+    void init_throttle(const char *name);
+    void finish_call();
 
     static void _getregistry(lua_State *, const char *name);
 
@@ -189,8 +208,8 @@ private:
 
     bool proc_returns(const char *par) const;
 
-    bool calltopfn(lua_State *ls, const char *format, va_list args,
-                   int retc = -1, va_list *fnr = nullptr);
+    bool calltopfn(lua_State *ls, const char *fn, const char *format,
+                   va_list args, int retc = -1, va_list *fnr = nullptr);
     maybe_bool callmbooleanfn(const char *fn, const char *params,
                               va_list args);
     maybe_bool callmaybefn(const char *fn, const char *params,
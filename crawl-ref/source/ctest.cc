@@ -29,6 +29,7 @@
 #include "item-name.h"
 #include "jobs.h"
 #include "libutil.h"
+#include "los.h"
 #include "mapdef.h"
 #include "maps.h"
 #include "message.h"
@@ -200,6 +201,7 @@ void run_tests()
         _run_test("mon-data", debug_mondata);
         _run_test("mon-spell", debug_monspells);
         _run_test("coordit", coordit_tests);
+        _run_test("los", los_tests);
         _run_test("makename", make_name_tests);
         _run_test("job-data", debug_jobdata);
         _run_test("mon-bands", debug_bands);
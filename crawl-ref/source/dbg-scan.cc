@@ -330,6 +330,13 @@ void debug_mons_scan()
         ASSERT(m->mid > 0);
         coord_def pos = m->pos();
 
+        if (!env.mons_in_use.contains(i))
+        {
+            mprf(MSGCH_ERROR, "Monster %s (midx = %d) is missing from "
+                              "env.mons_in_use; monster_iterator skips it.",
+                 m->full_name(DESC_PLAIN).c_str(), i);
+        }
+
         if (invalid_monster_type(m->type))
         {
             mprf(MSGCH_ERROR, "Bogus monster type %d at (%d, %d), midx = %d",
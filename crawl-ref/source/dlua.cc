@@ -21,6 +21,41 @@ static int dlua_compiled_chunk_writer(lua_State *ls, const void *p,
     return 0;
 }
 
+// Registry table of loaded chunk functions, indexed by owner and context.
+#define DLUA_CHUNK_CACHE "dlua_chunk_cache"
+
+static bool _push_cached_chunk(CLua &interp, const string &key)
+{
+    interp.getregistry(DLUA_CHUNK_CACHE);
+    if (!lua_istable(interp, -1))
+    {
+        lua_pop(interp, 1);
+        return false;
+    }
+    lua_getfield(interp, -1, key.c_str());
+    lua_remove(interp, -2);
+    if (lua_isfunction(interp, -1))
+        return true;
+    lua_pop(interp, 1);
+    return false;
+}
+
+// Remember the function on top of the stack, leaving it there.
+static void _cache_chunk(CLua &interp, const string &key)
+{
+    interp.getregistry(DLUA_CHUNK_CACHE);
+    if (!lua_istable(interp, -1))
+    {
+        lua_pop(interp, 1);
+        lua_newtable(interp);
+        lua_pushvalue(interp, -1);
+        interp.setregistry(DLUA_CHUNK_CACHE);
+    }
+    lua_pushvalue(interp, -2);
+    lua_setfield(interp, -2, key.c_str());
+    lua_pop(interp, 1);
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // dlua_chunk
 
@@ -147,21 +182,37 @@ int dlua_chunk::check_op(CLua &interp, int err)
     return err;
 }
 
-int dlua_chunk::load(CLua &interp)
+int dlua_chunk::load(CLua &interp, const string &cache_owner)
 {
-    if (!compiled.empty())
-    {
-        return check_op(interp,
-                         interp.loadbuffer(compiled.c_str(), compiled.length(),
-                                           context.c_str()));
-    }
-
     if (empty())
     {
         chunk.clear();
         return E_CHUNK_LOAD_FAILURE;
     }
 
+    string cache_key;
+    if (!cache_owner.empty())
+    {
+        cache_key = cache_owner + ":" + context;
+        if (_push_cached_chunk(interp, cache_key))
+        {
+            // As if it had just loaded successfully.
+            interp.error.clear();
+            return check_op(interp, 0);
+        }
+    }
+
+    if (!compiled.empty())
+    {
+        const int err = check_op(interp,
+                                 interp.loadbuffer(compiled.c_str(),
+                                                   compiled.length(),
+                                                   context.c_str()));
+        if (!err && !cache_key.empty())
+            _cache_chunk(interp, cache_key);
+        return err;
+    }
+
     int err = check_op(interp,
                         interp.loadstring(chunk.c_str(), context.c_str()));
     if (err)
@@ -174,6 +225,8 @@ int dlua_chunk::load(CLua &interp)
         error = e? e : "Unknown error compiling chunk";
         lua_pop(interp, 2);
     }
+    else if (!cache_key.empty())
+        _cache_chunk(interp, cache_key);
     compiled = out.str();
     return err;
 }
@@ -198,6 +251,14 @@ int dlua_chunk::load_call(CLua &interp, const char *fn)
     return check_op(interp, !interp.callfn(fn, fn? 1 : 0, 0));
 }
 
+// Forget every function kept by load(), e.g. because the maps that own them
+// have been reread.
+void dlua_chunk::clear_cache(CLua &interp)
+{
+    lua_pushnil(interp);
+    interp.setregistry(DLUA_CHUNK_CACHE);
+}
+
 string dlua_chunk::orig_error() const
 {
     rewrite_chunk_errors(error);
@@ -55,7 +55,11 @@ public:
     void add(int line, const string &line2);
     void set_chunk(const string &s);
 
-    int load(CLua &interp);
+    // If cache_owner is given, the loaded function is kept in the Lua
+    // registry under the owner and this chunk's context, and later loads
+    // for the same owner reuse it instead of parsing the chunk again. The
+    // owner must not change its chunks until clear_cache() is called.
+    int load(CLua &interp, const string &cache_owner = "");
     int run(CLua &interp);
     int load_call(CLua &interp, const char *function);
     void set_file(const string &s);
@@ -70,6 +74,8 @@ public:
 
     void write(writer&) const;
     void read(reader&);
+
+    static void clear_cache(CLua &interp);
 };
 
 void init_dungeon_lua();
@@ -950,6 +950,16 @@ static bool _dgn_square_is_ever_passable(const coord_def &c)
 
 static inline void _dgn_point_record_stub(const coord_def &) { }
 
+static inline bool _dgn_zone_open(const coord_def &c,
+                                   bool (*passable)(const coord_def &))
+{
+    return map_bounds(c) && !travel_point_distance[c.x][c.y] && passable(c);
+}
+
+// Labels every square 8-connected to start with zone, scanline fashion: each
+// seed is widened into a horizontal run, and the runs touching it above and
+// below (diagonals included) are queued as new seeds. record_point is
+// called for every square in the zone but start.
 template <class point_record>
 static bool _dgn_fill_zone(
     const coord_def &start, int zone,
@@ -958,40 +968,51 @@ static bool _dgn_fill_zone(
     bool (*iswanted)(const coord_def &) = nullptr)
 {
     bool ret = false;
-    list<coord_def> points[2];
-    int cur = 0;
     int found_points = 0;
+    vector<coord_def> seeds;
+    seeds.reserve(GYM);
 
-    // No bounds checks, assuming the level has at least one layer of
-    // rock border.
-
-    for (points[cur].push_back(start); !points[cur].empty();)
+    for (seeds.push_back(start); !seeds.empty();)
     {
-        for (const auto &c : points[cur])
+        const coord_def seed = seeds.back();
+        seeds.pop_back();
+
+        // Filled from another seed in the same run since being queued.
+        if (travel_point_distance[seed.x][seed.y])
+            continue;
+
+        const int y = seed.y;
+        int x1 = seed.x, x2 = seed.x;
+        while (_dgn_zone_open(coord_def(x1 - 1, y), passable))
+            --x1;
+        while (_dgn_zone_open(coord_def(x2 + 1, y), passable))
+            ++x2;
+
+        for (int x = x1; x <= x2; ++x)
         {
-            travel_point_distance[c.x][c.y] = zone;
+            const coord_def c(x, y);
+            travel_point_distance[x][y] = zone;
             found_points++;
 
             if (iswanted && iswanted(c))
                 ret = true;
 
-            for (adjacent_iterator ai(c); ai; ++ai)
-            {
-                const coord_def& cp = *ai;
-                if (!map_bounds(cp)
-                    || travel_point_distance[cp.x][cp.y] || !passable(cp))
-                {
-                    continue;
-                }
+            if (c != start)
+                record_point(c);
+        }
 
-                travel_point_distance[cp.x][cp.y] = zone;
-                record_point(cp);
-                points[!cur].push_back(cp);
+        for (int yi = -1; yi <= 1; yi += 2)
+        {
+            bool in_run = false;
+            for (int x = x1 - 1; x <= x2 + 1; ++x)
+            {
+                const coord_def cp(x, y + yi);
+                const bool open = _dgn_zone_open(cp, passable);
+                if (open && !in_run)
+                    seeds.push_back(cp);
+                in_run = open;
             }
         }
-
-        points[cur].clear();
-        cur = !cur;
     }
     dprf("Zone %d contains %d points from seed %d,%d", zone, found_points,
         start.x, start.y);
@@ -1067,6 +1088,14 @@ static bool _is_exit_stair(const coord_def &c)
     }
 }
 
+// Zone counts for the whole map, as left by the last flood.
+struct zone_census
+{
+    bool valid = false;
+    int zones = 0;
+    int stairless = 0;
+};
+
 // Counts the number of mutually unreachable areas in the map,
 // excluding isolated zones within vaults (we assume the vault author
 // knows what she's doing). This is an easy way to check whether a map
@@ -1101,17 +1130,26 @@ static bool _is_exit_stair(const coord_def &c)
 //
 // If fill is non-zero, it fills any disconnected regions with fill.
 //
+// If census is non-null (and choose_stairless is set), it is given the zone
+// counts the area is left with after filling, so that callers needn't flood
+// the map again to ask. It stays invalid if a zone was only partly filled,
+// since what is left of that zone may have been split up.
+//
 // TODO: refactor this to something more usable
 static int _process_disconnected_zones(int x1, int y1, int x2, int y2,
                 bool choose_stairless,
                 dungeon_feature_type fill,
                 bool (*passable)(const coord_def &) = _dgn_square_is_passable,
                 bool (*fill_check)(const coord_def &) = nullptr,
-                int fill_small_zones = 0)
+                int fill_small_zones = 0,
+                zone_census *census = nullptr)
 {
     memset(travel_point_distance, 0, sizeof(travel_distance_grid_t));
     int nzones = 0;
     int ngood = 0;
+    int nfilled = 0;
+    bool split = false;
+    vector<coord_def> zone_points;
     for (int y = y1; y <= y2 ; ++y)
     {
         for (int x = x1; x <= x2; ++x)
@@ -1124,11 +1162,18 @@ static int _process_disconnected_zones(int x1, int y1, int x2, int y2,
             }
 
             int zone_size = 0;
-            auto inc_zone_size = [&zone_size](const coord_def &) { zone_size++; };
+            zone_points.clear();
+            zone_points.emplace_back(x, y);
+            auto record_zone_point = [&zone_size, &zone_points]
+                                     (const coord_def &c)
+            {
+                zone_size++;
+                zone_points.push_back(c);
+            };
 
             const bool found_exit_stair =
                 _dgn_fill_zone(coord_def(x, y), ++nzones,
-                               inc_zone_size,
+                               record_zone_point,
                                passable,
                                choose_stairless ? (at_branch_bottom() ?
                                                    _is_upwards_exit_stair :
@@ -1148,23 +1193,17 @@ static int _process_disconnected_zones(int x1, int y1, int x2, int y2,
                 bool veto = false;
                 vector<coord_def> coords;
                 dprf("Filling zone %d", nzones);
-                for (int fy = y1; fy <= y2 ; ++fy)
+                for (auto c : zone_points)
                 {
-                    for (int fx = x1; fx <= x2; ++fx)
+                    if (c.x < x1 || c.x > x2 || c.y < y1 || c.y > y2)
+                        continue;
+                    if (map_masked(c, MMT_VAULT))
                     {
-                        if (travel_point_distance[fx][fy] == nzones)
-                        {
-                            if (map_masked(coord_def(fx, fy), MMT_VAULT))
-                            {
-                                veto = true;
-                                break;
-                            }
-                            else if (!fill_check || fill_check(coord_def(fx, fy)))
-                                coords.emplace_back(fx, fy);
-                        }
-                    }
-                    if (veto)
+                        veto = true;
                         break;
+                    }
+                    else if (!fill_check || fill_check(c))
+                        coords.push_back(c);
                 }
                 if (!veto)
                 {
@@ -1189,11 +1228,26 @@ static int _process_disconnected_zones(int x1, int y1, int x2, int y2,
                                         KILL_RESET, NON_MONSTER, false, true);
                         }
                     }
+
+                    if (coords.size() == zone_points.size()
+                        && !passable(zone_points[0]))
+                    {
+                        ++nfilled;
+                    }
+                    else if (!coords.empty())
+                        split = true;
                 }
             }
         }
     }
 
+    if (census)
+    {
+        census->valid = choose_stairless && !split;
+        census->zones = nzones - nfilled;
+        census->stairless = nzones - ngood - nfilled;
+    }
+
     return nzones - ngood;
 }
 
@@ -1214,15 +1268,26 @@ int dgn_count_disconnected_zones(bool choose_stairless,
                                        fill);
 }
 
-static void _fill_small_disconnected_zones()
+// Counts all zones and stairless zones in a single flood.
+static zone_census _count_disconnected_zones()
+{
+    zone_census census;
+    _process_disconnected_zones(0, 0, GXM-1, GYM-1, true, DNGN_UNSEEN,
+                                _dgn_square_is_passable, nullptr, 0, &census);
+    return census;
+}
+
+static zone_census _fill_small_disconnected_zones()
 {
     // debugging tip: change the feature to something like lava that will be
     // very noticeable.
     // TODO: make even more aggressive, up to ~25?
+    zone_census census;
     _process_disconnected_zones(0, 0, GXM-1, GYM-1, true, DNGN_ROCK_WALL,
                                        _dgn_square_is_passable,
                                        _dgn_square_is_boring,
-                                       10);
+                                       10, &census);
+    return census;
 }
 
 static void _fixup_hell_stairs()
@@ -2146,6 +2211,11 @@ static bool _add_feat_if_missing(bool (*iswanted)(const coord_def &),
 {
     memset(travel_point_distance, 0, sizeof(travel_distance_grid_t));
     int nzones = 0;
+    vector<coord_def> zone_points;
+    auto record_zone_point = [&zone_points](const coord_def &c)
+    {
+        zone_points.push_back(c);
+    };
     for (int y = 0; y < GYM; ++y)
         for (int x = 0; x < GXM; ++x)
         {
@@ -2162,17 +2232,18 @@ static bool _add_feat_if_missing(bool (*iswanted)(const coord_def &),
                 continue;
             }
 
-            if (_dgn_fill_zone(gc, ++nzones, _dgn_point_record_stub,
+            zone_points.clear();
+            zone_points.push_back(gc);
+            if (_dgn_fill_zone(gc, ++nzones, record_zone_point,
                                _dgn_square_is_passable, iswanted))
             {
                 continue;
             }
 
             bool found_feature = false;
-            for (rectangle_iterator ri(0); ri; ++ri)
+            for (auto c : zone_points)
             {
-                if (env.grid(*ri) == feat
-                    && travel_point_distance[ri->x][ri->y] == nzones)
+                if (env.grid(c) == feat)
                 {
                     found_feature = true;
                     break;
@@ -2202,17 +2273,22 @@ static bool _add_feat_if_missing(bool (*iswanted)(const coord_def &),
             if (found_feature)
                 continue;
 
-            for (rectangle_iterator ri(0); ri; ++ri)
+            // The first floor square in map order, as a last resort.
+            coord_def first_floor(-1, -1);
+            for (auto c : zone_points)
             {
-                if (env.grid(*ri) != DNGN_FLOOR)
-                    continue;
-
-                if (travel_point_distance[ri->x][ri->y] != nzones)
-                    continue;
+                if (env.grid(c) == DNGN_FLOOR
+                    && (first_floor.x < 0 || c.y < first_floor.y
+                        || c.y == first_floor.y && c.x < first_floor.x))
+                {
+                    first_floor = c;
+                }
+            }
 
-                _set_grd(*ri, feat);
+            if (first_floor.x >= 0)
+            {
+                _set_grd(first_floor, feat);
                 found_feature = true;
-                break;
             }
 
             if (found_feature)
@@ -2292,12 +2368,17 @@ static void _dgn_verify_connectivity(unsigned nvaults)
 {
     // After placing vaults, make sure parts of the level have not been
     // disconnected.
+    // Filling small zones counts what is left as it goes, and the zone check
+    // counts stairless zones too, so this usually floods the map only once.
+    zone_census census;
     if (dgn_zones && nvaults != env.level_vaults.size())
     {
         if (!player_in_branch(BRANCH_ABYSS))
-            _fill_small_disconnected_zones();
+            census = _fill_small_disconnected_zones();
+        if (!census.valid)
+            census = _count_disconnected_zones();
 
-        const int newzones = dgn_count_disconnected_zones(false);
+        const int newzones = census.zones;
 
 #ifdef DEBUG_STATISTICS
         ostringstream vlist;
@@ -2326,7 +2407,8 @@ static void _dgn_verify_connectivity(unsigned nvaults)
     // Also check for isolated regions that have no stairs.
     if (player_in_connected_branch()
         && !(branches[you.where_are_you].branch_flags & brflag::islanded)
-        && dgn_count_disconnected_zones(true) > 0)
+        && (census.valid ? census.stairless
+                         : dgn_count_disconnected_zones(true)) > 0)
     {
         throw dgn_veto_exception("Isolated areas with no stairs.");
     }
@@ -4515,7 +4597,7 @@ static const vault_placement *_build_vault_impl(const map_def *vault,
             throw dgn_veto_exception("Pan map with disconnected zones");
     }
 
-    if (crawl_state.game_is_descent() && vault->get_tags_unsorted().count("no_descent"))
+    if (crawl_state.game_is_descent() && vault->has_tag("no_descent"))
         throw dgn_veto_exception("Illegal map for descent");
 
     unwind_var<string> placing(env.placing_vault, vault->name);
@@ -21,6 +21,7 @@
 #include "god-passive.h"
 #include "ghost.h"
 #include "hints.h"
+#include "hiscores.h"
 #include "initfile.h"
 #include "invent.h"
 #include "item-prop.h"
@@ -431,6 +432,9 @@ NORETURN void end_game(scorefile_entry &se)
 
 NORETURN void game_ended(game_exit exit, const string &message)
 {
+    if (crawl_state.clua_profile)
+        logfile_lua_profile();
+
     if (crawl_state.marked_as_won &&
         (exit == game_exit::death || exit == game_exit::leave))
     {
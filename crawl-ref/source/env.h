@@ -24,6 +24,48 @@ typedef vector<unique_ptr<vault_placement>> vault_placement_refv;
 
 typedef FixedArray< map_cell, GXM, GYM > MapKnowledge;
 
+/**
+ * The env.mons slots that may hold a live monster. A slot joins when it is
+ * handed out, assigned a monster or loaded, and leaves when the monster in
+ * it is reset, so this is a superset of the live monsters that is small
+ * enough for monster_iterator to skip empty slots without touching them.
+ */
+class monster_slot_set
+{
+public:
+    monster_slot_set() : words() { }
+
+    void add(int i)    { words[i / WORD_BITS] |= uint64_t{1} << i % WORD_BITS; }
+    void remove(int i) { words[i / WORD_BITS] &= ~(uint64_t{1} << i % WORD_BITS); }
+    bool contains(int i) const
+    {
+        return words[i / WORD_BITS] >> i % WORD_BITS & 1;
+    }
+
+    // The first slot at or after i, or MAX_MONSTERS if there is none.
+    int next(int i) const
+    {
+        for (int w = i / WORD_BITS; w < NUM_WORDS; ++w, i = w * WORD_BITS)
+        {
+            uint64_t bits = words[w] >> i % WORD_BITS;
+            if (!bits)
+                continue;
+            while (!(bits & 1))
+            {
+                bits >>= 1;
+                ++i;
+            }
+            return i;
+        }
+        return MAX_MONSTERS;
+    }
+
+private:
+    static const int WORD_BITS = 64;
+    static const int NUM_WORDS = (MAX_MONSTERS + WORD_BITS - 1) / WORD_BITS;
+    uint64_t words[NUM_WORDS];
+};
+
 class final_effect;
 struct crawl_environment
 {
@@ -32,6 +74,7 @@ struct crawl_environment
 
     FixedVector< item_def, MAX_ITEMS >       item;  // item list
     FixedVector< monster, MAX_MONSTERS+2 >   mons;  // monster list, plus anon
+    monster_slot_set                         mons_in_use;
 
     feature_grid                             grid;  // terrain grid
     FixedArray<terrain_property_t, GXM, GYM> pgrid; // terrain properties
@@ -61,7 +104,7 @@ struct crawl_environment
 
     vector<coord_def>                        travel_trail;
 
-    map<coord_def, cloud_struct> cloud;
+    cloud_grid cloud;
 
     map<coord_def, shop_struct> shop; // shop list
     map<coord_def, trap_def> trap; // trap list
@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cinttypes>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
@@ -56,6 +57,7 @@
 #include "god-abil.h"
 #include "god-companions.h"
 #include "god-passive.h"
+#include "hash.h"
 #include "hints.h"
 #include "initfile.h"
 #include "item-name.h"
@@ -83,6 +85,7 @@
 #include "stringutil.h"
 #include "syscalls.h"
 #include "tag-version.h"
+#include "tags.h"
 #include "teleport.h"
 #include "terrain.h"
 #ifdef USE_TILE
@@ -1040,12 +1043,16 @@ void write_ghost_version(writer &outf)
         marshallInt(outf, 0);
 }
 
+// Marshal a chunk in memory; the save compresses it into the file later,
+// possibly on another thread.
 static void _write_tagged_chunk(const string &chunkname, tag_type tag)
 {
-    writer outf(you.save, chunkname);
+    vector<unsigned char> buf;
+    writer outf(&buf);
 
     write_save_version(outf, save_version::current());
     tag_write(tag, outf);
+    you.save->queue_chunk(chunkname, buf);
 }
 
 static int _get_dest_stair_type(dungeon_feature_type stair_taken,
@@ -1850,7 +1857,7 @@ static bool _branch_pregenerates(branch_type b)
 * levels are already generated, so the caller should check whether false is an
 * error case or trivial success (using the save chunk).
 */
-bool pregen_dungeon(const level_id &stopping_point)
+static bool _pregen_dungeon(const level_id &stopping_point)
 {
     // TODO: the is_valid() check here doesn't look quite right to me, but so
     // far I can't get it to break anything...
@@ -1956,6 +1963,251 @@ bool pregen_dungeon(const level_id &stopping_point)
     }
 }
 
+// Chunks of a pregen cache entry that aren't levels.
+#define PREGEN_KEY_CHUNK "pregen_key"
+#define PREGEN_STATE_CHUNK "pregen_state"
+
+static vector<char> _pregen_state()
+{
+    vector<unsigned char> buf;
+    writer th(&buf);
+    tag_write_pregen_state(th);
+    return vector<char>(buf.begin(), buf.end());
+}
+
+/**
+ * What a full pregen depends on: the version, the game type, the few player
+ * choices that the builder looks at, and the state that building levels
+ * reads and changes. Games with the same key get the same dungeon.
+ */
+static vector<char> _pregen_cache_key()
+{
+    string key = make_stringf("%s\n%d %d %d\n", Version::Long,
+                              static_cast<int>(crawl_state.type),
+                              static_cast<int>(you.species),
+                              static_cast<int>(you.religion));
+    vector<char> data(key.begin(), key.end());
+    const vector<char> state = _pregen_state();
+    data.insert(data.end(), state.begin(), state.end());
+    return data;
+}
+
+static string _pregen_cache_filename(const vector<char> &key)
+{
+    return catpath(SysEnv.pregen_cache_dir,
+                   make_stringf("%" PRIu64 "-%08x.pregen", you.game_seed,
+                                hash32(key.data(), key.size())));
+}
+
+static vector<char> _read_chunk(package *pkg, const string &name)
+{
+    chunk_reader cr(pkg, name);
+    vector<char> data;
+    cr.read_all(data);
+    return data;
+}
+
+static void _write_chunk(package *pkg, const string &name,
+                         const vector<char> &data)
+{
+    chunk_writer cw(pkg, name);
+    cw.write(data.data(), data.size());
+}
+
+typedef map<string, vector<char>> pregen_chunks;
+
+/**
+ * Read a pregen cache entry, if one exists for this key.
+ *
+ * @param filename    the cache entry.
+ * @param key         the key the entry must have been written under.
+ * @param[out] levels the level chunks.
+ * @param[out] state  the rest of the game state left by building them.
+ * @return whether a matching entry was read.
+ */
+static bool _read_pregen_cache(const string &filename, const vector<char> &key,
+                               pregen_chunks &levels, vector<char> &state)
+{
+    if (!file_exists(filename))
+        return false;
+
+    try
+    {
+        package cache(filename.c_str(), false);
+        if (!cache.has_chunk(PREGEN_KEY_CHUNK)
+            || !cache.has_chunk(PREGEN_STATE_CHUNK)
+            || _read_chunk(&cache, PREGEN_KEY_CHUNK) != key)
+        {
+            dprf("Pregen cache %s is for another game.", filename.c_str());
+            return false;
+        }
+
+        state = _read_chunk(&cache, PREGEN_STATE_CHUNK);
+        for (const string &name : cache.list_chunks())
+            if (name != PREGEN_KEY_CHUNK && name != PREGEN_STATE_CHUNK)
+                levels[name] = _read_chunk(&cache, name);
+    }
+    catch (ext_fail_exception &fe)
+    {
+        mprf(MSGCH_ERROR, "Can't read pregen cache %s: %s", filename.c_str(),
+             fe.what());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Publish a pregen cache entry. It is written under a temporary name and
+ * then renamed into place, so that other games never see it half-written.
+ */
+static void _write_pregen_cache(const string &filename, const vector<char> &key,
+                                const pregen_chunks &levels,
+                                const vector<char> &state)
+{
+    const string tmpname = make_stringf("%s.%d.tmp", filename.c_str(),
+                                        (int) getpid());
+    try
+    {
+        package cache(tmpname.c_str(), true, true);
+        _write_chunk(&cache, PREGEN_KEY_CHUNK, key);
+        _write_chunk(&cache, PREGEN_STATE_CHUNK, state);
+        for (const auto &level : levels)
+            _write_chunk(&cache, level.first, level.second);
+    }
+    catch (ext_fail_exception &fe)
+    {
+        mprf(MSGCH_ERROR, "Can't write pregen cache %s: %s", tmpname.c_str(),
+             fe.what());
+        unlink_u(tmpname.c_str());
+        return;
+    }
+
+    if (rename_u(tmpname.c_str(), filename.c_str()))
+    {
+        mprf(MSGCH_ERROR, "Can't rename %s to %s: %s", tmpname.c_str(),
+             filename.c_str(), strerror(errno));
+        unlink_u(tmpname.c_str());
+    }
+}
+
+/**
+ * Compare a freshly built dungeon against the cache entry for it.
+ *
+ * @return the number of chunks that differ, counting the game state as one.
+ */
+static int _verify_pregen_cache(const string &filename,
+                                const pregen_chunks &cached_levels,
+                                const vector<char> &cached_state,
+                                const pregen_chunks &levels,
+                                const vector<char> &state)
+{
+    int mismatches = 0;
+    for (const auto &level : levels)
+    {
+        auto cached = cached_levels.find(level.first);
+        if (cached == cached_levels.end() || cached->second != level.second)
+        {
+            mprf(MSGCH_ERROR, "Pregen cache %s: level %s %s.",
+                 filename.c_str(), level.first.c_str(),
+                 cached == cached_levels.end() ? "is missing" : "differs");
+            ++mismatches;
+        }
+    }
+    for (const auto &cached : cached_levels)
+    {
+        if (!levels.count(cached.first))
+        {
+            mprf(MSGCH_ERROR, "Pregen cache %s: extra level %s.",
+                 filename.c_str(), cached.first.c_str());
+            ++mismatches;
+        }
+    }
+    if (state != cached_state)
+    {
+        mprf(MSGCH_ERROR, "Pregen cache %s: game state differs.",
+             filename.c_str());
+        ++mismatches;
+    }
+
+    if (!mismatches)
+    {
+        mprf(MSGCH_DIAGNOSTICS, "Pregen cache %s: %u levels verified.",
+             filename.c_str(), (unsigned int) levels.size());
+    }
+    return mismatches;
+}
+
+/**
+ * Pregenerate the whole dungeon through the shared cache in
+ * SysEnv.pregen_cache_dir. The first game with a given key builds the levels
+ * as usual and publishes them; later games copy them into their save and
+ * restore the game state the builder left, instead of building anything.
+ * With SysEnv.pregen_cache_verify, games always build and compare what they
+ * built with the cache.
+ *
+ * Player ghosts in cached levels are the ones the game that built them got
+ * from its bones files, and a cache hit doesn't use any bones of its own.
+ */
+static bool _pregen_dungeon_cached(const level_id &stopping_point)
+{
+    const vector<char> key = _pregen_cache_key();
+    const string filename = _pregen_cache_filename(key);
+
+    pregen_chunks cached_levels;
+    vector<char> cached_state;
+    const bool cached = _read_pregen_cache(filename, key, cached_levels,
+                                           cached_state);
+
+    if (cached && !SysEnv.pregen_cache_verify)
+    {
+        dprf("Pregen: copying %u levels from %s.",
+             (unsigned int) cached_levels.size(), filename.c_str());
+        for (const auto &level : cached_levels)
+            _write_chunk(you.save, level.first, level.second);
+        const vector<unsigned char> buf(cached_state.begin(),
+                                        cached_state.end());
+        reader th(buf, TAG_MINOR_VERSION);
+        tag_read_pregen_state(th);
+        return true;
+    }
+
+    const vector<string> old_chunks = you.save->list_chunks();
+    const set<string> had(old_chunks.begin(), old_chunks.end());
+    if (!_pregen_dungeon(stopping_point))
+        return false;
+
+    pregen_chunks levels;
+    for (const string &name : you.save->list_chunks())
+        if (!had.count(name))
+            levels[name] = _read_chunk(you.save, name);
+    const vector<char> state = _pregen_state();
+
+    if (cached)
+    {
+        _verify_pregen_cache(filename, cached_levels, cached_state, levels,
+                             state);
+    }
+    else if (!file_exists(filename))
+        _write_pregen_cache(filename, key, levels, state);
+    return true;
+}
+
+/**
+ * Generate dungeon branches in a stable order; see _pregen_dungeon() for
+ * the details. A full pregen goes through the shared pregen cache, if the
+ * server has set one up.
+ */
+bool pregen_dungeon(const level_id &stopping_point)
+{
+    if (stopping_point.branch == NUM_BRANCHES
+        && !SysEnv.pregen_cache_dir.empty()
+        && you.deterministic_levelgen)
+    {
+        return _pregen_dungeon_cached(stopping_point);
+    }
+    return _pregen_dungeon(stopping_point);
+}
+
 static void _rescue_player_from_wall()
 {
     // n.b. you.wizmode_teleported_into_rock would be better, but it is not
@@ -2492,11 +2744,13 @@ void save_level(const level_id& lid)
 # define CHUNK(short, long) long
 #endif
 
-#define SAVEFILE(short, long, savefn)           \
-    do                                          \
-    {                                           \
-        writer w(you.save, CHUNK(short, long)); \
-        savefn(w);                              \
+#define SAVEFILE(short, long, savefn)                   \
+    do                                                  \
+    {                                                   \
+        vector<unsigned char> buf;                      \
+        writer w(&buf);                                 \
+        savefn(w);                                      \
+        you.save->queue_chunk(CHUNK(short, long), buf); \
     } while (false)
 
 // Stack allocated string's go in separate function, so Valgrind doesn't
@@ -2602,7 +2856,9 @@ void save_game(bool leave_game, const char *farewellmsg)
 #endif
         if (!crawl_state.disables[DIS_SAVE_CHECKPOINTS])
         {
-            you.save->commit();
+            // Compression and the commit finish while the player reads the
+            // screen; the next use of the save waits for them.
+            you.save->commit_in_background();
             save_game_prefs();
         }
         return;
@@ -26,6 +26,7 @@
 #include "branch.h"
 #include "chardump.h"
 #include "cio.h"
+#include "clua.h"
 #include "dungeon.h"
 #include "end.h"
 #include "english.h"
@@ -103,6 +104,26 @@ static string _log_file_name(bool milestones=false)
         + crawl_state.game_type_qualifier());
 }
 
+// Append the user-script Lua profile for this game to the luaprofile file
+// next to the logfile, so that servers can find expensive rc files.
+void logfile_lua_profile()
+{
+    if (clua.profile.empty())
+        return;
+
+    FILE *out = _hs_open("a", catpath(Options.shared_dir, "luaprofile"
+                                      + crawl_state.game_type_qualifier()));
+    if (!out)
+    {
+        mprf(MSGCH_ERROR, "ERROR: failure writing to the Lua profile.");
+        return;
+    }
+
+    clua.dump_profile(out, you.your_name);
+    _hs_close(out);
+    clua.profile.clear();
+}
+
 int hiscores_new_entry(const scorefile_entry &ne)
 {
     unwind_bool score_update(crawl_state.updating_scores, true);
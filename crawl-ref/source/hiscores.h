@@ -20,6 +20,7 @@ class scorefile_entry;
 int hiscores_new_entry(const scorefile_entry &se);
 
 void logfile_new_entry(const scorefile_entry &se);
+void logfile_lua_profile();
 
 void hiscores_read_to_memory();
 
@@ -3631,6 +3631,33 @@ void base_game_options::set_from_defaults(const string &opt)
     (*this)[opt].set_from(defaults[opt]);
 }
 
+// Set user-script Lua CPU time budgets from a comma-separated list of
+// milliseconds, each either bare (the default budget) or prefixed with the
+// function or hook it applies to, e.g. "250, ready:50, c_message:20".
+static bool _parse_lua_max_time(const string &spec)
+{
+    auto budgets = crawl_state.clua_max_time_ms;
+    for (const string &part : split_string(",", spec))
+    {
+        string fn;
+        string ms = part;
+        const string::size_type colon = part.rfind(':');
+        if (colon != string::npos)
+        {
+            fn = trimmed_string(part.substr(0, colon));
+            ms = trimmed_string(part.substr(colon + 1));
+        }
+
+        int budget;
+        if (!parse_int(ms.c_str(), budget) || budget < 0)
+            return false;
+        budgets[fn] = budget;
+    }
+
+    crawl_state.clua_max_time_ms = budgets;
+    return true;
+}
+
 /// Parse an option line. Meta-fields are handled directly in this function,
 /// e.g. fields that deal with option parsing state, loading of other files,
 /// etc. This function calls out to `read_custom_option` and any options
@@ -3671,6 +3698,15 @@ void base_game_options::read_option_line(const string &str, bool runscripts)
 #else
         if (!sscanf(state.field.c_str(), "%" SCNu64, &crawl_state.clua_max_memory_mb))
             report_error("Couldn't parse integer option lua_max_memory: \"%s\"", state.field.c_str());
+#endif
+    }
+    else if (state.key == "lua_max_time")
+    {
+#ifdef DGAMELAUNCH
+        report_error("Option 'lua_max_time' is disabled in this build.");
+#else
+        if (!_parse_lua_max_time(state.field))
+            report_error("Couldn't parse option lua_max_time: \"%s\"", state.field.c_str());
 #endif
     }
     else if (state.key == "lua_file")
@@ -4589,6 +4625,8 @@ enum commandline_option_type
     CLO_VERSION,
     CLO_SEED,
     CLO_PREGEN,
+    CLO_PREGEN_CACHE,
+    CLO_PREGEN_CACHE_VERIFY,
     CLO_SAVE_VERSION,
     CLO_SPRINT,
     CLO_EXTRA_OPT_FIRST,
@@ -4606,6 +4644,8 @@ enum commandline_option_type
     CLO_THROTTLE,
     CLO_NO_THROTTLE,
     CLO_CLUA_MAX_MEMORY,
+    CLO_CLUA_MAX_TIME,
+    CLO_CLUA_PROFILE,
     CLO_PLAYABLE_JSON, // JSON metadata for species, jobs, combos.
     CLO_BRANCHES_JSON, // JSON metadata for branches.
     CLO_SAVE_JSON,
@@ -4619,6 +4659,8 @@ enum commandline_option_type
     CLO_WEBTILES_SOCKET,
     CLO_AWAIT_CONNECTION,
     CLO_PRINT_WEBTILES_OPTIONS,
+    CLO_WEBTILES_BACKPRESSURE,
+    CLO_WEBTILES_QUEUE_SIZE,
 #endif
     CLO_RESET_CACHE,
 
@@ -4650,6 +4692,8 @@ static set<commandline_option_type> clo_headless_ok = {
     CLO_WEBTILES_SOCKET,
     CLO_AWAIT_CONNECTION,
     CLO_PRINT_WEBTILES_OPTIONS,
+    CLO_WEBTILES_BACKPRESSURE,
+    CLO_WEBTILES_QUEUE_SIZE,
     CLO_SAVE_JSON,
     CLO_GAMETYPES_JSON,
 #endif
@@ -4660,17 +4704,19 @@ static const char *cmd_ops[] =
     "scores", "name", "species", "background", "dir", "rc", "rcdir", "tscores",
     "vscores", "scorefile", "morgue", "macro", "mapstat", "dump-disconnect",
     "objstat", "iters", "force-map", "arena", "dump-maps", "test", "script",
-    "builddb", "help", "version", "seed", "pregen", "save-version", "sprint",
+    "builddb", "help", "version", "seed", "pregen", "pregen-cache",
+    "pregen-cache-verify", "save-version", "sprint",
     "extra-opt-first", "extra-opt-last", "sprint-map", "edit-save",
     "print-charset", "tutorial", "wizard", "explore", "no-save",
     "no-player-bones", "gdb", "no-gdb", "nogdb", "throttle", "no-throttle",
-    "lua-max-memory", "playable-json", "branches-json", "save-json",
+    "lua-max-memory", "lua-max-time", "lua-profile", "playable-json", "branches-json", "save-json",
     "gametypes-json", "bones", "descent",
 #if defined(UNIX) || defined(USE_TILE_LOCAL)
     "headless",
 #endif
 #ifdef USE_TILE_WEB
     "webtiles-socket", "await-connection", "print-webtiles-options",
+    "webtiles-backpressure", "webtiles-queue-size",
 #endif
     "reset-cache",
 };
@@ -4774,6 +4820,7 @@ enum es_command_type
     ES_GET,
     ES_PUT,
     ES_REPACK,
+    ES_RECOMPRESS,
     ES_INFO,
     NUM_ES
 };
@@ -4802,6 +4849,7 @@ static edit_command<es_command_type> es_commands[] =
     { ES_PUT,     "put",     true,  1, 2, },
     { ES_RM,      "rm",      true,  1, 1, },
     { ES_REPACK,  "repack",  false, 0, 0, },
+    { ES_RECOMPRESS, "recompress", false, 0, 1, },
     { ES_INFO,    "info",    false, 0, 0, },
 };
 
@@ -4826,6 +4874,10 @@ static void _edit_save(int argc, char **argv)
                "     <chunkfile> defaults to \"chunk\"; use \"-\" for stdout/stdin\n"
                "  rm <chunk>                  delete a chunk\n"
                "  repack                      defrag and reclaim unused space\n"
+               "  recompress [<codec>]        repack, compressing every chunk with\n"
+               "                              <codec> (zlib or zstd; default %s)\n",
+               save_codec_name(save_codec_supported(CODEC_ZSTD) ? CODEC_ZSTD
+                                                                : CODEC_ZLIB)
              );
         return;
     }
@@ -4926,13 +4978,32 @@ static void _edit_save(int argc, char **argv)
 
             save.delete_chunk(chunk);
         }
-        else if (cmd == ES_REPACK)
+        else if (cmd == ES_REPACK || cmd == ES_RECOMPRESS)
         {
+            save_codec codec = NUM_CODECS;
+            if (cmd == ES_RECOMPRESS)
+            {
+                codec = argc == 3 ? str_to_save_codec(argv[2])
+                      : save_codec_supported(CODEC_ZSTD) ? CODEC_ZSTD
+                                                         : CODEC_ZLIB;
+                if (codec == NUM_CODECS)
+                    FAIL("Unknown codec \"%s\".\n", argv[2]);
+                if (!save_codec_supported(codec))
+                {
+                    FAIL("This build can't compress with %s.\n",
+                         save_codec_name(codec));
+                }
+            }
+
             package save2((filename + ".tmp").c_str(), true, true);
             for (const string &chunk : save.list_chunks())
             {
                 char buf[16384];
 
+                // A plain repack keeps each chunk's codec.
+                save2.set_codec(cmd == ES_RECOMPRESS
+                                ? codec : save.get_chunk_codec(chunk));
+
                 chunk_reader in(&save, chunk);
                 chunk_writer out(&save2, chunk);
 
@@ -4951,7 +5022,7 @@ static void _edit_save(int argc, char **argv)
             plen_t frag = save.get_chunk_fragmentation("");
             plen_t flen = save.get_size();
             plen_t slack = save.get_slack();
-            printf("Chunks: (size compressed/uncompressed, fragments, name)\n");
+            printf("Chunks: (size compressed/uncompressed, fragments, codec, name)\n");
             for (const string &chunk : list)
             {
                 int cfrag = save.get_chunk_fragmentation(chunk);
@@ -4963,7 +5034,9 @@ static void _edit_save(int argc, char **argv)
                 plen_t clen = 0;
                 while (plen_t s = in.read(buf, sizeof(buf)))
                     clen += s;
-                printf("%7d/%7d %3u %s\n", cclen, clen, cfrag, chunk.c_str());
+                printf("%7d/%7d %3u %s %s\n", cclen, clen, cfrag,
+                       save_codec_name(save.get_chunk_codec(chunk)),
+                       chunk.c_str());
             }
             // the directory is not a chunk visible from the outside
             printf("Fragmentation:    %u/%u (%4.2f)\n", frag, nchunks + 1,
@@ -5919,6 +5992,19 @@ bool parse_args(int argc, char **argv, bool rc_only)
             Options.pregen_dungeon = level_gen_type::full;
             break;
 
+        case CLO_PREGEN_CACHE:
+            if (!next_is_param)
+                return false;
+            if (!rc_only)
+                SysEnv.pregen_cache_dir = next_arg;
+            nextUsed = true;
+            break;
+
+        case CLO_PREGEN_CACHE_VERIFY:
+            if (!rc_only)
+                SysEnv.pregen_cache_verify = true;
+            break;
+
         case CLO_SPRINT:
             if (!rc_only)
                 Options.game.type = GAME_TYPE_SPRINT;
@@ -5970,6 +6056,35 @@ bool parse_args(int argc, char **argv, bool rc_only)
                 end(0);
             }
             break;
+
+        case CLO_WEBTILES_BACKPRESSURE:
+            if (!next_is_param)
+                return false;
+
+            if (!strcmp(next_arg, "block"))
+                tiles.m_output.policy = web_backpressure::block;
+            else if (!strcmp(next_arg, "drop"))
+                tiles.m_output.policy = web_backpressure::drop;
+            else if (!strcmp(next_arg, "coalesce"))
+                tiles.m_output.policy = web_backpressure::coalesce;
+            else
+                return false;
+            nextUsed = true;
+            break;
+
+        case CLO_WEBTILES_QUEUE_SIZE:
+        {
+            if (!next_is_param)
+                return false;
+
+            // In kilobytes, per destination.
+            const int size = atoi(next_arg);
+            if (size <= 0)
+                return false;
+            tiles.m_output.capacity = size * 1024;
+            nextUsed = true;
+            break;
+        }
 #endif
 
         case CLO_PRINT_CHARSET:
@@ -6002,6 +6117,19 @@ bool parse_args(int argc, char **argv, bool rc_only)
             nextUsed = true;
             break;
 
+        case CLO_CLUA_MAX_TIME:
+            if (!next_is_param)
+                return false;
+
+            if (!_parse_lua_max_time(next_arg))
+                return false;
+            nextUsed = true;
+            break;
+
+        case CLO_CLUA_PROFILE:
+            crawl_state.clua_profile = true;
+            break;
+
         case CLO_EXTRA_OPT_FIRST:
             if (!next_is_param)
                 return false;
@@ -66,6 +66,10 @@ public:
     vector<string> extra_opts_first;
     vector<string> extra_opts_last;
 
+    string pregen_cache_dir;       // Where to share fully pregenerated
+                                   // dungeons between games, if anywhere.
+    bool pregen_cache_verify;      // Regenerate cached dungeons and compare.
+
 public:
     void add_rcdir(const string &dir);
 };
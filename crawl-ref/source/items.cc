@@ -3039,9 +3039,13 @@ static bool _is_option_autopickup(const item_def &item, bool ignore_force)
         return bool(res);
 
     // Check for initial settings
-    for (const pair<text_pattern, bool>& option : Options.force_autopickup)
-        if (option.first.matches(iname))
-            return option.second;
+    static pattern_set patterns;
+    patterns.update(Options.force_autopickup,
+                    [](const pair<text_pattern, bool>& option)
+                        -> const text_pattern& { return option.first; });
+    const int i = patterns.first_match(iname);
+    if (i >= 0)
+        return Options.force_autopickup[i].second;
 
     return Options.autopickups[item.base_type];
 }
@@ -5,6 +5,8 @@
 
 #include "l-libs.h"
 
+#include <chrono>
+
 #include "act-iter.h"
 #include "branch.h"
 #include "chardump.h"
@@ -15,6 +17,7 @@
 #include "files.h"
 #include "god-wrath.h"
 #include "los.h"
+#include "losglobal.h"
 #include "maps.h"
 #include "message.h"
 #include "mon-act.h"
@@ -22,11 +25,16 @@
 #include "mon-death.h"
 #include "mon-poly.h"
 #include "ng-setup.h"
+#include "notes.h"
+#include "package.h"
 #include "religion.h"
 #include "stairs.h"
+#include "stash.h"
 #include "state.h"
 #include "stringutil.h"
+#include "tags.h"
 #include "tileview.h"
+#include "travel.h"
 #include "unique-creature-list-type.h"
 #include "unwind.h"
 #include "view.h"
@@ -123,6 +131,112 @@ LUAFN(debug_reveal_mimics)
 
 LUAWRAP(debug_los_changed, los_changed())
 
+// Report the cell_see_cell() cache counters; pass true to reset them.
+LUAFN(debug_los_cache_stats)
+{
+    const los_cache_stats &stats = get_los_cache_stats();
+    const string r = make_stringf("hits: %" PRIu64 ", recomputes: %" PRIu64
+                                  ", invalidations: %" PRIu64
+                                  ", bytes cleared: %" PRIu64,
+                                  stats.hits, stats.recomputes,
+                                  stats.invalidations, stats.bytes_cleared);
+    if (lua_toboolean(ls, 1))
+        reset_los_cache_stats();
+    lua_pushstring(ls, r.c_str());
+    return 1;
+}
+
+extern void world_reacts();
+
+// Run world_reacts() turns times (default 1). Returns the milliseconds taken,
+// and how many monsters monster_iterator finds afterwards.
+LUAFN(debug_world_reacts)
+{
+    const int turns = lua_isnumber(ls, 1) ? luaL_safe_checkint(ls, 1) : 1;
+
+    const auto start = chrono::steady_clock::now();
+    for (int i = 0; i < turns; ++i)
+        world_reacts();
+    const chrono::duration<double, milli> elapsed =
+        chrono::steady_clock::now() - start;
+
+    int monsters = 0;
+    for (monster_iterator mi; mi; ++mi)
+        ++monsters;
+
+    lua_pushnumber(ls, elapsed.count());
+    lua_pushnumber(ls, monsters);
+    return 2;
+}
+
+// Save the current level copies times (default 1) into a scratch save, along
+// with the chunks save_game() writes alongside it, then read everything back.
+// Level chunks are read whole as tag_read() does, the rest a byte at a time
+// as their unmarshalling does. Returns the milliseconds spent saving and
+// loading, and the number of uncompressed bytes.
+LUAFN(debug_save_throughput)
+{
+    const int copies = lua_isnumber(ls, 1) ? luaL_safe_checkint(ls, 1) : 1;
+    package save;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < copies; ++i)
+    {
+        writer outf(&save, make_stringf("lvl%d", i));
+        write_save_version(outf, save_version::current());
+        tag_write(TAG_LEVEL, outf);
+    }
+    {
+        writer outf(&save, "stashes");
+        StashTrack.save(outf);
+    }
+    {
+        writer outf(&save, "travel_cache");
+        travel_cache.save(outf);
+    }
+    {
+        writer outf(&save, "kills");
+        you.kills.save(outf);
+    }
+    {
+        writer outf(&save, "notes");
+        save_notes(outf);
+    }
+    {
+        writer outf(&save, "messages");
+        save_messages(outf);
+    }
+    save.commit();
+    const chrono::duration<double, milli> saving =
+        chrono::steady_clock::now() - start;
+
+    double bytes = 0;
+    start = chrono::steady_clock::now();
+    for (const string &name : save.list_chunks())
+    {
+        chunk_reader inf(&save, name);
+        if (starts_with(name, "lvl"))
+        {
+            vector<char> data;
+            inf.read_all(data);
+            bytes += data.size();
+        }
+        else
+        {
+            char byte;
+            while (inf.read(&byte, 1))
+                ++bytes;
+        }
+    }
+    const chrono::duration<double, milli> loading =
+        chrono::steady_clock::now() - start;
+
+    lua_pushnumber(ls, saving.count());
+    lua_pushnumber(ls, loading.count());
+    lua_pushnumber(ls, bytes);
+    return 3;
+}
+
 LUAFN(debug_builder_ignore_depth)
 {
     const bool b = lua_toboolean(ls, 1);
@@ -486,6 +600,9 @@ const struct luaL_reg debug_dlib[] =
 { "generate_level", debug_generate_level },
 { "reveal_mimics", debug_reveal_mimics },
 { "los_changed", debug_los_changed },
+{ "los_cache_stats", debug_los_cache_stats },
+{ "world_reacts", debug_world_reacts },
+{ "save_throughput", debug_save_throughput },
 { "dump_map", debug_dump_map },
 { "vault_names", debug_vault_names },
 { "test_explore", _debug_test_explore },
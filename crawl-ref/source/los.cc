@@ -46,14 +46,24 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <set>
 
 #include "areas.h"
 #include "coord.h"
 #include "coordit.h"
 #include "env.h"
+#include "files.h"
 #include "losglobal.h"
+#include "maps.h"
 #include "mon-act.h"
 #include "mpr.h"
+#include "random.h"
+#include "state.h"
+#include "syscalls.h"
+#include "tags.h"
+#include "version.h"
 
 // These determine what rays are cast in the precomputation,
 // and affect start-up time significantly.
@@ -61,6 +71,10 @@
 #define LOS_MAX_ANGLE (2*LOS_MAX_RANGE-2)
 #define LOS_INTERCEPT_MULT (2)
 
+// The registered rays depend only on the above, so they are cached in
+// the des cache directory. Bump this when changing how rays are cast.
+#define LOS_RAY_CACHE_VERSION 1
+
 // These store all unique (in terms of footprint) full rays.
 // The footprint of ray=fullray[i] consists of ray.length cells,
 // stored in ray_coords[ray.start..ray.length-1].
@@ -70,6 +84,10 @@ struct los_ray;
 static vector<los_ray> fullrays;
 static vector<coord_def> ray_coords;
 
+// Footprints of the rays in fullrays, for weeding out duplicates.
+// Only used while casting rays.
+static set<vector<coord_def>> fullray_footprints;
+
 // These store all unique minimal cellrays. For each i,
 // cellray i ends in cellray_ends[i] and passes through
 // those cells p that have blockrays(p)[i] set. In other
@@ -91,6 +109,76 @@ static FixedArray<vector<cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> min_cellray
 static bit_vector *dead_rays     = nullptr;
 static bit_vector *smoke_rays    = nullptr;
 
+// A set of cells in one quadrant, one bit per cell. The quadrant
+// has (LOS_MAX_RANGE+1)^2 cells, which needs a couple of words.
+#define QUADRANT_SIDE  (LOS_MAX_RANGE + 1)
+#define QUADRANT_WORDS ((QUADRANT_SIDE * QUADRANT_SIDE + 63) / 64)
+
+struct quadrant_mask
+{
+    uint64_t words[QUADRANT_WORDS];
+
+    quadrant_mask()
+    {
+        for (uint64_t &w : words)
+            w = 0;
+    }
+
+    static int bit(const coord_def& p)
+    {
+        return p.y * QUADRANT_SIDE + p.x;
+    }
+
+    void set(const coord_def& p)
+    {
+        words[bit(p) / 64] |= (uint64_t)1 << (bit(p) % 64);
+    }
+
+    bool get(const coord_def& p) const
+    {
+        return words[bit(p) / 64] & ((uint64_t)1 << (bit(p) % 64));
+    }
+
+    // Do the two sets have any cell in common?
+    bool meets(const quadrant_mask& other) const
+    {
+        uint64_t common = 0;
+        for (int i = 0; i < QUADRANT_WORDS; ++i)
+            common |= words[i] & other.words[i];
+        return common;
+    }
+
+    // Do the two sets have at least two cells in common?
+    bool meets_twice(const quadrant_mask& other) const
+    {
+        bool seen = false;
+        for (int i = 0; i < QUADRANT_WORDS; ++i)
+        {
+            const uint64_t common = words[i] & other.words[i];
+            if (common & (common - 1))
+                return true;
+            if (common)
+            {
+                if (seen)
+                    return true;
+                seen = true;
+            }
+        }
+        return false;
+    }
+};
+
+// The transpose of blockrays: ray_blockers[i] is the set of cells
+// that block the minimal cellray with index i. This lets losight()
+// decide whether a ray is dead with a few word-wide ANDs instead of
+// OR-ing a bit_vector for every opaque cell.
+static vector<quadrant_mask> ray_blockers;
+
+// For each target cell in the quadrant, the cells lying on some minimal
+// cellray to it, i.e. the cells whose opacity decides whether the target
+// is visible from the origin.
+static FixedArray<quadrant_mask, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> cells_between;
+
 class quadrant_iterator : public rectangle_iterator
 {
 public:
@@ -109,6 +197,24 @@ void clear_rays_on_exit()
         delete blockrays(*qi);
 }
 
+// Forget all precomputed data, so that it can be computed again.
+static void _clear_rays()
+{
+    clear_rays_on_exit();
+    dead_rays = smoke_rays = nullptr;
+    for (quadrant_iterator qi; qi; ++qi)
+    {
+        blockrays(*qi) = nullptr;
+        min_cellrays(*qi).clear();
+        cells_between(*qi) = quadrant_mask();
+    }
+    fullrays.clear();
+    ray_coords.clear();
+    fullray_footprints.clear();
+    cellray_ends.clear();
+    ray_blockers.clear();
+}
+
 // LOS radius.
 int los_radius = LOS_DEFAULT_RANGE;
 
@@ -181,26 +287,6 @@ struct los_ray : public ray_def
     }
 };
 
-// Check if the passed rays have identical footprint.
-static bool _is_same_ray(los_ray ray, vector<coord_def> newray)
-{
-    if (ray.length != newray.size())
-        return false;
-    for (unsigned int i = 0; i < ray.length; i++)
-        if (ray[i] != newray[i])
-            return false;
-    return true;
-}
-
-// Check if the passed ray has already been created.
-static bool _is_duplicate_ray(vector<coord_def> newray)
-{
-    for (los_ray lray : fullrays)
-        if (_is_same_ray(lray, newray))
-            return true;
-    return false;
-}
-
 // A cellray given by fullray and index of end-point.
 struct cellray
 {
@@ -373,7 +459,7 @@ static void _register_ray(geom::ray r)
     los_ray ray = los_ray(r);
     vector<coord_def> coords = ray.footprint();
 
-    if (coords.empty() || _is_duplicate_ray(coords))
+    if (coords.empty() || !fullray_footprints.insert(coords).second)
         return;
 
     ray.start = ray_coords.size();
@@ -429,6 +515,17 @@ static void _create_blockrays()
     for (quadrant_iterator qi; qi; ++qi)
         delete all_blockrays(*qi);
 
+    // Transpose the compressed blockrays for the bitboard backend.
+    ray_blockers.assign(n_min_rays, quadrant_mask());
+    for (quadrant_iterator qi; qi; ++qi)
+        for (int i = 0; i < n_min_rays; ++i)
+            if (blockrays(*qi)->get(i))
+                ray_blockers[i].set(*qi);
+
+    for (int i = 0; i < n_min_rays; ++i)
+        for (int w = 0; w < QUADRANT_WORDS; ++w)
+            cells_between(cellray_ends[i]).words[w] |= ray_blockers[i].words[w];
+
     dead_rays  = new bit_vector(n_min_rays);
     smoke_rays = new bit_vector(n_min_rays);
 
@@ -454,17 +551,9 @@ static bool _complexity_lt(const pair<int,int>& lhs, const pair<int,int>& rhs)
     return lhs.first * lhs.second < rhs.first * rhs.second;
 }
 
-// Cast all rays
-static void raycast()
+// Cast all rays in the first quadrant.
+static void _cast_rays()
 {
-    static bool done_raycast = false;
-    if (done_raycast)
-        return;
-
-    // Creating all rays for first quadrant
-    // We have a considerable amount of overkill.
-    done_raycast = true;
-
     // register perpendiculars FIRST, to make them top choice
     // when selecting beams
     _register_ray(geom::ray(0.5, 0.5, 0.0, 1.0));
@@ -503,8 +592,173 @@ static void raycast()
         }
     }
 
-    // Now create the appropriate blockrays array
+    fullray_footprints.clear();
+}
+
+void los_compute_rays()
+{
+    _clear_rays();
+    _cast_rays();
+    _create_blockrays();
+}
+
+// Doubles are stored bit for bit, so that loaded rays behave exactly
+// like freshly cast ones.
+static void _marshall_double(writer &th, double d)
+{
+    uint64_t bits;
+    COMPILE_CHECK(sizeof(bits) == sizeof(d));
+    memcpy(&bits, &d, sizeof(bits));
+    marshallUnsigned(th, bits);
+}
+
+static double _unmarshall_double(reader &th)
+{
+    const uint64_t bits = unmarshallUnsigned(th);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static void _marshall_ray_cache_header(writer &th)
+{
+    write_save_version(th, save_version::current());
+    marshallString(th, Version::Long);
+    marshallInt(th, LOS_RAY_CACHE_VERSION);
+    marshallInt(th, LOS_RADIUS);
+    marshallInt(th, LOS_MAX_ANGLE);
+    marshallInt(th, LOS_INTERCEPT_MULT);
+}
+
+static bool _verify_ray_cache_header(reader &th)
+{
+    const auto version = get_save_version(th);
+    return version.major == TAG_MAJOR_VERSION
+           && version.minor == TAG_MINOR_VERSION
+           && unmarshallString(th) == Version::Long
+           && unmarshallInt(th) == LOS_RAY_CACHE_VERSION
+           && unmarshallInt(th) == LOS_RADIUS
+           && unmarshallInt(th) == LOS_MAX_ANGLE
+           && unmarshallInt(th) == LOS_INTERCEPT_MULT;
+}
+
+bool los_save_rays(const string &file)
+{
+    if (fullrays.empty())
+        return false;
+
+    file_lock lock(file + ".lk", "wb", false);
+    FILE *fp = fopen_u(file.c_str(), "wb");
+    if (!fp)
+        return false;
+
+    writer outf(file, fp, true);
+    _marshall_ray_cache_header(outf);
+    marshallInt(outf, fullrays.size());
+    for (const los_ray &ray : fullrays)
+    {
+        _marshall_double(outf, ray.r.start.x);
+        _marshall_double(outf, ray.r.start.y);
+        _marshall_double(outf, ray.r.dir.x);
+        _marshall_double(outf, ray.r.dir.y);
+        marshallInt(outf, ray.start);
+        marshallInt(outf, ray.length);
+    }
+    marshallInt(outf, ray_coords.size());
+    for (const coord_def &c : ray_coords)
+        marshallCoord(outf, c);
+
+    const bool ok = outf.succeeded();
+    fclose(fp);
+    if (!ok)
+        unlink_u(file.c_str());
+    return ok;
+}
+
+static bool _read_rays(reader &inf)
+{
+    if (!_verify_ray_cache_header(inf))
+        return false;
+
+    const int nrays = unmarshallInt(inf);
+    if (nrays <= 0)
+        return false;
+    for (int i = 0; i < nrays; ++i)
+    {
+        const double x0 = _unmarshall_double(inf);
+        const double y0 = _unmarshall_double(inf);
+        const double xd = _unmarshall_double(inf);
+        const double yd = _unmarshall_double(inf);
+        const int start = unmarshallInt(inf);
+        const int length = unmarshallInt(inf);
+        if (start < 0 || length <= 0)
+            return false;
+        los_ray ray(geom::ray(x0, y0, xd, yd));
+        ray.start = start;
+        ray.length = length;
+        fullrays.push_back(ray);
+    }
+
+    const int ncoords = unmarshallInt(inf);
+    for (int i = 0; i < ncoords; ++i)
+    {
+        const coord_def c = unmarshallCoord(inf);
+        if (c.x < 0 || c.y < 0 || c.rdist() > LOS_MAX_RANGE)
+            return false;
+        ray_coords.push_back(c);
+    }
+
+    // Both are non-negative ints, so their sum can't wrap in a size_t.
+    for (const los_ray &ray : fullrays)
+        if ((size_t)ray.start + ray.length > ray_coords.size())
+            return false;
+
+    return true;
+}
+
+bool los_load_rays(const string &file)
+{
+    _clear_rays();
+
+    file_lock lock(file + ".lk", "rb", false);
+    FILE *fp = fopen_u(file.c_str(), "rb");
+    if (!fp)
+        return false;
+
+    bool ok = false;
+    try
+    {
+        reader inf(fp, TAG_MINOR_VERSION);
+        ok = _read_rays(inf);
+    }
+    catch (short_read_exception &E)
+    {
+    }
+    fclose(fp);
+
+    if (!ok)
+    {
+        _clear_rays();
+        return false;
+    }
     _create_blockrays();
+    return true;
+}
+
+// Cast all rays, or load them from the cache.
+static void raycast()
+{
+    if (!fullrays.empty())
+        return;
+
+    const string cache = crawl_state.use_des_cache
+                         ? get_descache_path("los", ".rays") : "";
+    if (cache.empty() || !los_load_rays(cache))
+    {
+        los_compute_rays();
+        if (!cache.empty())
+            los_save_rays(cache);
+    }
 }
 
 static int _imbalance(ray_def ray, const coord_def& target)
@@ -545,8 +799,9 @@ void cellray::calc_params()
 // Find ray in positive quadrant.
 // opc has been translated for this quadrant.
 // XXX: Allow finding ray of minimum opacity.
+template<class O>
 static bool _find_ray_se(const coord_def& target, ray_def& ray,
-                  const opacity_func& opc, int range, bool cycle)
+                         const O& opc, int range, bool cycle)
 {
     ASSERT(target.x >= 0);
     ASSERT(target.y >= 0);
@@ -590,21 +845,33 @@ static bool _find_ray_se(const coord_def& target, ray_def& ray,
     return true;
 }
 
+// Opacity under standard rules, skipping the opacity_func.
+struct opacity_rules
+{
+    los_type rules;
+
+    opacity_rules(los_type l) : rules(l) {}
+
+    opacity_type operator()(const coord_def &p) const
+    {
+        return los_opacity(p, rules);
+    }
+};
+
 // Coordinate transformation so we can find_ray quadrant-by-quadrant.
-struct opacity_trans : public opacity_func
+template<class O>
+struct opacity_trans
 {
     const coord_def& source;
     int signx, signy;
-    const opacity_func& orig;
+    const O& orig;
 
-    opacity_trans(const opacity_func& opc, const coord_def& s, int sx, int sy)
+    opacity_trans(const O& opc, const coord_def& s, int sx, int sy)
         : source(s), signx(sx), signy(sy), orig(opc)
     {
     }
 
-    CLONE(opacity_trans)
-
-    opacity_type operator()(const coord_def &l) const override
+    opacity_type operator()(const coord_def &l) const
     {
         return orig(transform(l));
     }
@@ -634,10 +901,23 @@ bool find_ray(const coord_def& source, const coord_def& target,
     const int absx  = signx * (target.x - source.x);
     const int absy  = signy * (target.y - source.y);
     const coord_def abs = coord_def(absx, absy);
-    opacity_trans opc_trans = opacity_trans(opc, source, signx, signy);
 
-    if (!_find_ray_se(abs, ray, opc_trans, range, cycle))
-        return false;
+    const los_type rules = opc.rules();
+    if (rules != LOS_NONE)
+    {
+        const opacity_rules opc_rules(rules);
+        const opacity_trans<opacity_rules> opc_trans(opc_rules, source,
+                                                     signx, signy);
+        if (!_find_ray_se(abs, ray, opc_trans, range, cycle))
+            return false;
+    }
+    else
+    {
+        const opacity_trans<opacity_func> opc_trans(opc, source,
+                                                    signx, signy);
+        if (!_find_ray_se(abs, ray, opc_trans, range, cycle))
+            return false;
+    }
 
     if (signx < 0)
         ray.r.start.x = 1.0 - ray.r.start.x;
@@ -681,6 +961,25 @@ dungeon_feature_type ray_blocker(const coord_def& source,
     return NUM_FEATURES;
 }
 
+// Could the opacity of the cell at offset blocker change whether the
+// cell at offset target is visible from the origin? Both offsets are
+// relative to the origin; the endpoints themselves never matter.
+bool los_cell_between(const coord_def& target, const coord_def& blocker)
+{
+    if (target.rdist() > LOS_MAX_RANGE || blocker.rdist() > LOS_MAX_RANGE)
+        return false;
+    // Targets on an axis are seen through both adjacent quadrants.
+    if (target.x * blocker.x < 0 || target.y * blocker.y < 0)
+        return false;
+    if (blocker.origin() || blocker == target)
+        return false;
+
+    raycast();
+    const coord_def t(abs(target.x), abs(target.y));
+    const coord_def b(abs(blocker.x), abs(blocker.y));
+    return cells_between(t).get(b);
+}
+
 // Returns a straight ray from source to target.
 void fallback_ray(const coord_def& source, const coord_def& target,
                   ray_def& ray)
@@ -733,7 +1032,13 @@ bool cell_see_cell_nocache(const coord_def& p1, const coord_def& p2)
 // Smoke will now only block LOS after two cells of smoke. This is
 // done by updating with a second array.
 
-static void _losight_quadrant(los_grid& sh, const los_param& dat, int sx, int sy)
+static const int quadrant_x[4] = {  1, -1, -1,  1 };
+static const int quadrant_y[4] = {  1,  1, -1, -1 };
+
+// The original backend: sweep the quadrant, OR-ing the blockrays of
+// every opaque cell into dead_rays.
+template<class P>
+static void _losight_quadrant(los_grid& sh, const P& dat, int sx, int sy)
 {
     const unsigned int num_cellrays = cellray_ends.size();
 
@@ -778,7 +1083,77 @@ static void _losight_quadrant(los_grid& sh, const los_param& dat, int sx, int sy
     }
 }
 
-struct los_param_funcs : public los_param
+template<class P>
+static void _losight_rays(los_grid& sh, const P& dat)
+{
+    for (int q = 0; q < 4; ++q)
+        _losight_quadrant(sh, dat, quadrant_x[q], quadrant_y[q]);
+}
+
+// Opacity of one quadrant as bitboards, in quadrant coordinates.
+struct quadrant_opacity
+{
+    quadrant_mask bounds; // cells passing los_bounds
+    quadrant_mask opaque;
+    quadrant_mask half;
+};
+
+// The bitboard backend. Opacity is queried once per cell of the LOS
+// square (cells on the axes belong to several quadrants), and then
+// a ray is dead iff its blockers meet an opaque cell or meet two
+// half-opaque cells. This is the same condition the sweep in
+// _losight_quadrant() accumulates, so the results are identical.
+template<class P>
+static void _losight_bitboard(los_grid& sh, const P& dat)
+{
+    quadrant_opacity quads[4];
+
+    for (int y = -LOS_MAX_RANGE; y <= LOS_MAX_RANGE; ++y)
+        for (int x = -LOS_MAX_RANGE; x <= LOS_MAX_RANGE; ++x)
+        {
+            const coord_def p(x, y);
+            if (!dat.los_bounds(p))
+                continue;
+
+            const coord_def qp(abs(x), abs(y));
+            const opacity_type opc = dat.opacity(p);
+            for (int q = 0; q < 4; ++q)
+            {
+                if (x * quadrant_x[q] < 0 || y * quadrant_y[q] < 0)
+                    continue;
+                quads[q].bounds.set(qp);
+                if (opc == OPC_OPAQUE)
+                    quads[q].opaque.set(qp);
+                else if (opc == OPC_HALF)
+                    quads[q].half.set(qp);
+            }
+        }
+
+    const unsigned int num_cellrays = cellray_ends.size();
+    for (int q = 0; q < 4; ++q)
+    {
+        const quadrant_opacity &quad = quads[q];
+        for (unsigned int rayidx = 0; rayidx < num_cellrays; ++rayidx)
+        {
+            const coord_def &end = cellray_ends[rayidx];
+            if (!quad.bounds.get(end))
+                continue;
+
+            const quadrant_mask &blockers = ray_blockers[rayidx];
+            if (blockers.meets(quad.opaque)
+                || blockers.meets_twice(quad.half))
+            {
+                continue;
+            }
+
+            sh(coord_def(quadrant_x[q] * end.x, quadrant_y[q] * end.y)) = true;
+        }
+    }
+}
+
+// The LOS parameters are passed to the backends by their final type, so
+// that the per-cell calls don't need to be virtual.
+struct los_param_funcs final : public los_param
 {
     coord_def center;
     const opacity_func& opc;
@@ -801,26 +1176,130 @@ struct los_param_funcs : public los_param
     }
 };
 
-void losight(los_grid& sh, const coord_def& center,
-             const opacity_func& opc, const circle_def& bounds)
+// Standard LOS rules, read straight from the opacity plane.
+struct los_param_rules final : public los_param
 {
-    const los_param& dat = los_param_funcs(center, opc, bounds);
+    coord_def center;
+    los_type rules;
+    const circle_def& bounds;
+
+    los_param_rules(const coord_def& c, los_type l, const circle_def& b)
+        : center(c), rules(l), bounds(b)
+    {
+    }
+
+    bool los_bounds(const coord_def& p) const override
+    {
+        return map_bounds(p + center) && bounds.contains(p);
+    }
+
+    opacity_type opacity(const coord_def& p) const override
+    {
+        return los_opacity(p + center, rules);
+    }
+};
 
+template<class P>
+static void _losight(los_grid& sh, const P& dat)
+{
     sh.init(false);
 
     // Do precomputations if necessary.
     raycast();
 
-    const int quadrant_x[4] = {  1, -1, -1,  1 };
-    const int quadrant_y[4] = {  1,  1, -1, -1 };
-    for (int q = 0; q < 4; ++q)
-        _losight_quadrant(sh, dat, quadrant_x[q], quadrant_y[q]);
+#ifdef LOS_RAY_BITVECTORS
+    _losight_rays(sh, dat);
+#else
+    _losight_bitboard(sh, dat);
+#endif
 
     // Center is always visible.
     const coord_def o = coord_def(0,0);
     sh(o) = true;
 }
 
+void losight(los_grid& sh, const coord_def& center,
+             const opacity_func& opc, const circle_def& bounds)
+{
+    const los_type rules = opc.rules();
+    if (rules != LOS_NONE)
+        _losight(sh, los_param_rules(center, rules, bounds));
+    else
+        _losight(sh, los_param_funcs(center, opc, bounds));
+}
+
+#ifdef DEBUG_TESTS
+// Random opacity, for comparing the LOS backends.
+class opacity_random : public opacity_func
+{
+public:
+    opacity_random(const FixedArray<opacity_type, GXM, GYM>& g) : grid(g) {}
+
+    CLONE(opacity_random)
+
+    opacity_type operator()(const coord_def& p) const override
+    {
+        return grid(p);
+    }
+private:
+    const FixedArray<opacity_type, GXM, GYM>& grid;
+};
+
+void los_tests()
+{
+    raycast();
+
+    FixedArray<opacity_type, GXM, GYM> grid;
+    const opacity_random opc(grid);
+    const circle_def shapes[] =
+    {
+        BDS_DEFAULT,
+        circle_def(LOS_RADIUS, C_ROUND),
+        circle_def(LOS_DEFAULT_RANGE, C_SQUARE),
+        circle_def(2, C_CIRCLE),
+    };
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        // Vary the density so that both open and cramped layouts
+        // (and lots of clouds) get tested.
+        const int opaque = random2(40);
+        const int half = random2(40);
+        for (rectangle_iterator ri(0); ri; ++ri)
+        {
+            const int roll = random2(100);
+            grid(*ri) = roll < opaque        ? OPC_OPAQUE :
+                        roll < opaque + half ? OPC_HALF
+                                             : OPC_CLEAR;
+        }
+
+        // Include centres near and on the map edges.
+        const coord_def center(random2(GXM), random2(GYM));
+        for (const circle_def &bds : shapes)
+        {
+            const los_param_funcs dat(center, opc, bds);
+            los_grid rays, bits;
+            rays.init(false);
+            bits.init(false);
+            _losight_rays(rays, dat);
+            _losight_bitboard(bits, dat);
+
+            for (int y = -LOS_MAX_RANGE; y <= LOS_MAX_RANGE; ++y)
+                for (int x = -LOS_MAX_RANGE; x <= LOS_MAX_RANGE; ++x)
+                {
+                    const coord_def p(x, y);
+                    if (rays(p) != bits(p))
+                    {
+                        die("LOS backends disagree at %d,%d from %d,%d: "
+                            "rays %d, bitboard %d", x, y,
+                            center.x, center.y, rays(p), bits(p));
+                    }
+                }
+        }
+    }
+}
+#endif
+
 opacity_type mons_opacity(const monster* mon, los_type how)
 {
     // no regard for LOS_ARENA
@@ -871,6 +1350,7 @@ void los_monster_died(const monster* mon)
 // Might want to pass new/old terrain.
 void los_terrain_changed(const coord_def& p)
 {
+    invalidate_opacity_plane(p);
     invalidate_los_around(p);
     _handle_los_change();
 }
@@ -878,6 +1358,7 @@ void los_terrain_changed(const coord_def& p)
 void los_changed()
 {
     mons_reset_just_seen();
+    invalidate_opacity_plane();
     invalidate_los();
     _handle_los_change();
 }
@@ -33,10 +33,14 @@ void fallback_ray(const coord_def& source, const coord_def& target,
                   ray_def& ray);
 
 bool cell_see_cell_nocache(const coord_def& p1, const coord_def& p2);
+bool los_cell_between(const coord_def& target, const coord_def& blocker);
 
 typedef SquareArray<bool, LOS_MAX_RANGE> los_grid;
 
 void clear_rays_on_exit();
+void los_compute_rays();
+bool los_load_rays(const string &file);
+bool los_save_rays(const string &file);
 void losight(los_grid& sh, const coord_def& center,
              const opacity_func &opc = opc_default,
              const circle_def &bds = BDS_DEFAULT);
@@ -46,3 +50,7 @@ void los_monster_died(const monster* mon);
 void los_terrain_changed(const coord_def& p);
 void los_changed();
 opacity_type mons_opacity(const monster* mon, los_type how);
+
+#ifdef DEBUG_TESTS
+void los_tests();
+#endif
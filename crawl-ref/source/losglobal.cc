@@ -5,6 +5,7 @@
 #include "coord.h"
 #include "coordit.h"
 #include "libutil.h"
+#include "los.h"
 #include "los-def.h"
 
 #define LOS_KNOWN 4
@@ -17,6 +18,23 @@ typedef halflos_t globallos_t[GXM][GYM];
 
 static globallos_t globallos;
 
+// invalidate_los() bumps the generation instead of clearing globallos;
+// a source's halflos_t is cleared when it is next touched.
+static uint32_t globallos_gen[GXM][GYM];
+static uint32_t los_generation = 1;
+
+static los_cache_stats cache_stats;
+
+static halflos_t& _halflos_at(const coord_def& p)
+{
+    if (globallos_gen[p.x][p.y] != los_generation)
+    {
+        memset(globallos[p.x][p.y], 0, sizeof(halflos_t));
+        globallos_gen[p.x][p.y] = los_generation;
+    }
+    return globallos[p.x][p.y];
+}
+
 static losfield_t* _lookup_globallos(const coord_def& p, const coord_def& q)
 {
     COMPILE_CHECK(LOS_KNOWN * 2 <= sizeof(losfield_t) * 8);
@@ -28,9 +46,9 @@ static losfield_t* _lookup_globallos(const coord_def& p, const coord_def& q)
         return nullptr;
     // p < q iff p.x < q.x || p.x == q.x && p.y < q.y
     if (diff < coord_def(0, 0))
-        return &globallos[q.x][q.y][-diff.x + o_half_x][-diff.y + o_half_y];
+        return &_halflos_at(q)[-diff.x + o_half_x][-diff.y + o_half_y];
     else
-        return &globallos[p.x][p.y][ diff.x + o_half_x][ diff.y + o_half_y];
+        return &_halflos_at(p)[ diff.x + o_half_x][ diff.y + o_half_y];
 }
 
 static void _save_los(los_def* los, los_type l)
@@ -58,22 +76,84 @@ static void _save_los(los_def* los, los_type l)
         }
 }
 
-// Opacity at p has changed.
+// For a cell at offset d from a source, los_dependents[d] lists the
+// entries of the source's halflos_t (as indices into the flattened
+// array) that may depend on the opacity of that cell. Pairs are stored
+// at only one end, so these cover lines of sight computed from either.
+static vector<uint16_t> los_dependents[2*LOS_MAX_RANGE+1][2*LOS_MAX_RANGE+1];
+
+static void _init_los_dependents()
+{
+    static bool done = false;
+    if (done)
+        return;
+    done = true;
+
+    for (int dx = -LOS_MAX_RANGE; dx <= LOS_MAX_RANGE; ++dx)
+        for (int dy = -LOS_MAX_RANGE; dy <= LOS_MAX_RANGE; ++dy)
+        {
+            const coord_def d(dx, dy);
+            vector<uint16_t> &deps = los_dependents[dx + LOS_MAX_RANGE]
+                                                   [dy + LOS_MAX_RANGE];
+            for (int x = 0; x <= LOS_MAX_RANGE; ++x)
+                for (int y = -LOS_MAX_RANGE; y <= LOS_MAX_RANGE; ++y)
+                {
+                    const coord_def diff(x, y);
+                    // Stored at the other end.
+                    if (diff < coord_def(0, 0))
+                        continue;
+                    if (los_cell_between(diff, d)
+                        || los_cell_between(-diff, d - diff))
+                    {
+                        deps.push_back((x + o_half_x) * (2*LOS_MAX_RANGE+1)
+                                       + y + o_half_y);
+                    }
+                }
+        }
+}
+
+// Opacity at p has changed. Only the pairs that have a line of sight
+// through p are forgotten.
 void invalidate_los_around(const coord_def& p)
 {
+    _init_los_dependents();
+    ++cache_stats.invalidations;
+
     int x1 = max(p.x - LOS_MAX_RANGE, 0);
     int y1 = max(p.y - LOS_MAX_RANGE, 0);
     int x2 = min(p.x, GXM - 1);
     int y2 = min(p.y + LOS_MAX_RANGE, GYM - 1);
     for (int y = y1; y <= y2; y++)
         for (int x = x1; x <= x2; x++)
-            memset(globallos[x][y], 0, sizeof(halflos_t));
+        {
+            // Nothing known here anyway.
+            if (globallos_gen[x][y] != los_generation)
+                continue;
+
+            losfield_t *flags = &globallos[x][y][0][0];
+            const vector<uint16_t> &deps =
+                los_dependents[p.x - x + LOS_MAX_RANGE][p.y - y + LOS_MAX_RANGE];
+            for (uint16_t i : deps)
+                flags[i] = 0;
+            cache_stats.bytes_cleared += deps.size() * sizeof(losfield_t);
+        }
 }
 
 void invalidate_los()
 {
-    for (rectangle_iterator ri(0); ri; ++ri)
-        memset(globallos[ri->x][ri->y], 0, sizeof(halflos_t));
+    ++los_generation;
+    ++cache_stats.invalidations;
+    cache_stats.bytes_cleared += sizeof(globallos);
+}
+
+const los_cache_stats& get_los_cache_stats()
+{
+    return cache_stats;
+}
+
+void reset_los_cache_stats()
+{
+    cache_stats = los_cache_stats();
 }
 
 static void _update_globallos_at(const coord_def& p, los_type l)
@@ -124,7 +204,12 @@ bool cell_see_cell(const coord_def& p, const coord_def& q, los_type l)
         return false; // outside range
 
     if (!(*flags & (l << LOS_KNOWN)))
+    {
+        ++cache_stats.recomputes;
         _update_globallos_at(p, l);
+    }
+    else
+        ++cache_stats.hits;
 
     ASSERT(*flags & (l << LOS_KNOWN));
     return *flags & l;
@@ -5,4 +5,19 @@
 void invalidate_los_around(const coord_def& p);
 void invalidate_los();
 
+// Counters for the cell_see_cell() cache. A recompute is a lookup that
+// missed and ran a full LOS calculation around one of the endpoints.
+// bytes_cleared counts what invalidation zeroed (or, for a full
+// invalidation, logically discarded).
+struct los_cache_stats
+{
+    uint64_t hits = 0;
+    uint64_t recomputes = 0;
+    uint64_t invalidations = 0;
+    uint64_t bytes_cleared = 0;
+};
+
+const los_cache_stats& get_los_cache_stats();
+void reset_los_cache_stats();
+
 bool cell_see_cell(const coord_def& p, const coord_def& q, los_type l);
@@ -8,8 +8,11 @@
 #include "losparam.h"
 
 #include "cloud.h"
+#include "coordit.h"
 #include "env.h"
 #include "los.h"
+#include "message.h"
+#include "mon-util.h"
 #include "state.h"
 #include "terrain.h"
 
@@ -23,16 +26,123 @@ const opacity_solid_see opc_solid_see = opacity_solid_see();
 const opacity_no_actor opc_no_actor = opacity_no_actor();
 const opacity_excl opc_excl = opacity_excl();
 
+// Opacity due to terrain and clouds under the standard rules, i.e.
+// everything except monsters.
+static opacity_type _feature_opacity(const coord_def& p, los_type l)
+{
+    const dungeon_feature_type f = env.grid(p);
+    switch (l)
+    {
+    case LOS_DEFAULT:
+        if (feat_is_opaque(f))
+            return OPC_OPAQUE;
+        break;
+    case LOS_NO_TRANS:
+        if (feat_is_opaque(f) || feat_is_wall(f) || feat_is_closed_door(f))
+            return OPC_OPAQUE;
+        break;
+    case LOS_SOLID:
+        // Clouds don't block line of effect.
+        return feat_is_solid(f) ? OPC_OPAQUE : OPC_CLEAR;
+    case LOS_SOLID_SEE:
+        if (feat_is_solid(f))
+            return OPC_OPAQUE;
+        break;
+    default:
+        die("invalid opacity");
+    }
+    return is_opaque_cloud(cloud_type_at(p)) ? OPC_HALF : OPC_CLEAR;
+}
+
+// The opacity plane caches _feature_opacity() for every cell, two bits
+// per los_type, holding the opacity plus one. A cell of 0 hasn't been
+// computed since it was last invalidated. Monsters aren't cached: they
+// enter and leave cells by too many paths, and monster_at() is cheap.
+static FixedArray<uint8_t, GXM, GYM> opacity_plane;
+
+static const los_type plane_types[] =
+{
+    LOS_DEFAULT, LOS_NO_TRANS, LOS_SOLID, LOS_SOLID_SEE
+};
+
+static int _plane_shift(los_type l)
+{
+    switch (l)
+    {
+    case LOS_DEFAULT:   return 0;
+    case LOS_NO_TRANS:  return 2;
+    case LOS_SOLID:     return 4;
+    case LOS_SOLID_SEE: return 6;
+    default:
+        die("invalid opacity");
+    }
+}
+
+opacity_type los_opacity(const coord_def& p, los_type l)
+{
+    opacity_type opc;
+    // The builder changes terrain without telling us.
+    if (crawl_state.generating_level)
+        opc = _feature_opacity(p, l);
+    else
+    {
+        uint8_t &cell = opacity_plane(p);
+        if (!cell)
+        {
+            for (los_type t : plane_types)
+                cell |= (_feature_opacity(p, t) + 1) << _plane_shift(t);
+        }
+        opc = static_cast<opacity_type>((cell >> _plane_shift(l) & 3) - 1);
+    }
+
+    if (opc == OPC_CLEAR)
+        if (const monster *mon = monster_at(p))
+            return mons_opacity(mon, l);
+    return opc;
+}
+
+void invalidate_opacity_plane(const coord_def& p)
+{
+    opacity_plane(p) = 0;
+}
+
+void invalidate_opacity_plane()
+{
+    opacity_plane.init(0);
+}
+
+#ifdef DEBUG
+// Complain about any cached cell that no longer matches env.grid and the
+// clouds, i.e. a terrain change that bypassed set_terrain_changed().
+void debug_opacity_scan()
+{
+    if (crawl_state.generating_level)
+        return;
+
+    for (rectangle_iterator ri(0); ri; ++ri)
+    {
+        const uint8_t cell = opacity_plane(*ri);
+        if (!cell)
+            continue;
+        for (los_type t : plane_types)
+        {
+            const int cached = (cell >> _plane_shift(t) & 3) - 1;
+            if (cached != _feature_opacity(*ri, t))
+            {
+                mprf(MSGCH_ERROR, "Stale opacity %d for %s at (%d, %d), "
+                                  "los_type %d",
+                     cached, dungeon_feature_name(env.grid(*ri)),
+                     ri->x, ri->y, t);
+                break;
+            }
+        }
+    }
+}
+#endif
+
 opacity_type opacity_default::operator()(const coord_def& p) const
 {
-    dungeon_feature_type f = env.grid(p);
-    if (feat_is_opaque(f))
-        return OPC_OPAQUE;
-    else if (is_opaque_cloud(cloud_type_at(p)))
-        return OPC_HALF;
-    else if (const monster *mon = monster_at(p))
-        return mons_opacity(mon, LOS_DEFAULT);
-    return OPC_CLEAR;
+    return los_opacity(p, LOS_DEFAULT);
 }
 
 opacity_type opacity_fullyopaque::operator()(const coord_def& p) const
@@ -45,14 +155,7 @@ opacity_type opacity_fullyopaque::operator()(const coord_def& p) const
 
 opacity_type opacity_no_trans::operator()(const coord_def& p) const
 {
-    dungeon_feature_type f = env.grid(p);
-    if (feat_is_opaque(f) || feat_is_wall(f) || feat_is_closed_door(f))
-        return OPC_OPAQUE;
-    else if (is_opaque_cloud(cloud_type_at(p)))
-        return OPC_HALF;
-    else if (const monster *mon = monster_at(p))
-        return mons_opacity(mon, LOS_NO_TRANS);
-    return OPC_CLEAR;
+    return los_opacity(p, LOS_NO_TRANS);
 }
 
 opacity_type opacity_fully_no_trans::operator()(const coord_def& p) const
@@ -80,26 +183,14 @@ opacity_type opacity_mons_immob::operator()(const coord_def& p) const
 
 opacity_type opacity_solid::operator()(const coord_def& p) const
 {
-    dungeon_feature_type f = env.grid(p);
-    if (feat_is_solid(f))
-        return OPC_OPAQUE;
-
-    return OPC_CLEAR;
+    return los_opacity(p, LOS_SOLID);
 }
 
 // Make anything solid block in addition to normal LOS.
 // That includes statues and grates in addition to opacity_no_trans.
 opacity_type opacity_solid_see::operator()(const coord_def& p) const
 {
-    dungeon_feature_type f = env.grid(p);
-    if (feat_is_solid(f))
-        return OPC_OPAQUE;
-    else if (is_opaque_cloud(cloud_type_at(p)))
-        return OPC_HALF;
-    else if (const monster *mon = monster_at(p))
-        return mons_opacity(mon, LOS_SOLID_SEE);
-
-    return OPC_CLEAR;
+    return los_opacity(p, LOS_SOLID_SEE);
 }
 
 opacity_type opacity_monmove::operator()(const coord_def& p) const
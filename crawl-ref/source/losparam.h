@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "los-type.h"
+
 // Note: find_ray relies on the fact that 2*OPC_HALF == OPC_OPAQUE.
 // On the other hand, losight tracks this explicitly.
 enum opacity_type
@@ -22,6 +24,10 @@ public:
     virtual opacity_type operator()(const coord_def& p) const = 0;
     virtual ~opacity_func() {}
     virtual opacity_func* clone() const = 0;
+
+    // The standard LOS rules this implements, if any. LOS code may then
+    // call los_opacity() directly instead of going through operator().
+    virtual los_type rules() const { return LOS_NONE; }
 };
 
 #define CLONE(typename) \
@@ -37,6 +43,7 @@ public:
     CLONE(opacity_default)
 
     opacity_type operator()(const coord_def& p) const override;
+    los_type rules() const override { return LOS_DEFAULT; }
 };
 extern const opacity_default opc_default;
 
@@ -60,6 +67,7 @@ public:
     CLONE(opacity_no_trans)
 
     opacity_type operator()(const coord_def& p) const override;
+    los_type rules() const override { return LOS_NO_TRANS; }
 };
 extern const opacity_no_trans opc_no_trans;
 
@@ -109,6 +117,7 @@ public:
     CLONE(opacity_solid)
 
     opacity_type operator()(const coord_def& p) const override;
+    los_type rules() const override { return LOS_SOLID; }
 };
 extern const opacity_solid opc_solid;
 
@@ -119,6 +128,7 @@ public:
     CLONE(opacity_solid_see)
 
     opacity_type operator()(const coord_def& p) const override;
+    los_type rules() const override { return LOS_SOLID_SEE; }
 };
 extern const opacity_solid_see opc_solid_see;
 
@@ -160,6 +170,17 @@ public:
 };
 extern const opacity_excl opc_excl;
 
+// Opacity of p under the standard rules of the given los_type (one of
+// LOS_DEFAULT, LOS_NO_TRANS, LOS_SOLID and LOS_SOLID_SEE). The terrain and
+// cloud part of this is cached in the opacity plane, which has to be
+// invalidated whenever either changes; see los_terrain_changed().
+opacity_type los_opacity(const coord_def& p, los_type l);
+void invalidate_opacity_plane(const coord_def& p);
+void invalidate_opacity_plane();
+#ifdef DEBUG
+void debug_opacity_scan();
+#endif
+
 // Subclasses of this are passed to losight() to modify the
 // LOS calculation. Implementations will have to translate between
 // relative coordinates (-8,-8)..(8,8) and real coordinates,
@@ -156,3 +156,26 @@ void debug_terp_dlua(CLua &vm)
     }
     _run_dlua_interpreter(vm);
 }
+
+// List the CPU time used by top-level calls into a managed Lua VM, most
+// expensive first.
+void debug_lua_profile(const CLua &vm)
+{
+    const vector<pair<string, CLua::call_profile>> funcs
+        = vm.sorted_profile();
+    if (funcs.empty())
+    {
+        mpr("No user Lua calls have been timed.");
+        return;
+    }
+
+    mprf(MSGCH_DIAGNOSTICS, "%-24s %8s %10s %8s %6s",
+         "function", "calls", "total ms", "max ms", "killed");
+    for (unsigned int i = 0; i < funcs.size(); i++)
+    {
+        const CLua::call_profile &prof = funcs[i].second;
+        mprf(MSGCH_DIAGNOSTICS, i+1, // inhibit merging
+             "%-24s %8u %10.2f %8.2f %6u", funcs[i].first.c_str(),
+             prof.calls, prof.total_ms, prof.max_ms, prof.kills);
+    }
+}
@@ -4,4 +4,5 @@
 #include "dlua.h"
 
 void debug_terp_dlua(CLua &vm = dlua);
+void debug_lua_profile(const CLua &vm = clua);
 bool luaterp_running();
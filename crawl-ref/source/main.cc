@@ -86,6 +86,7 @@
 #include "level-state-type.h"
 #include "libutil.h"
 #include "lookup-help.h"
+#include "losparam.h"
 #include "luaterp.h"
 #include "macro.h"
 #include "makeitem.h"
@@ -537,6 +538,9 @@ static void _show_commandline_options_help()
     puts("  -lua-max-memory       max memory in MB allowed for user Lua scripts");
     puts("  -seed <number>        specify a game seed to use when creating a new game");
 #endif
+    puts("  -lua-max-time <ms>    CPU time budget for each user Lua call, either");
+    puts("                        <ms> or <fn>:<ms>, comma separated");
+    puts("  -lua-profile          log user Lua CPU time per function at game end");
 
     puts("");
 
@@ -599,6 +603,10 @@ static void _show_commandline_options_help()
     puts("  -playable-json   list playable species, jobs, and character combos.");
     puts("  -branches-json   list branch data.");
     puts("  -no-player-bones do not write player's info to bones files.");
+    puts("  -pregen-cache <dir> share fully pregenerated dungeons between games");
+    puts("      with the same seed through <dir>");
+    puts("  -pregen-cache-verify regenerate cached dungeons and report any "
+         "difference");
 
 #if defined(TARGET_OS_WINDOWS) && defined(USE_TILE_LOCAL)
     text_popup(help, L"Dungeon Crawl command line help");
@@ -1210,8 +1218,8 @@ static void _input()
                     mprf(MSGCH_ERROR, "Lua error: %s", clua.error.c_str());
                     if (crawl_state.lua_ready_throttled)
                     {
-                        mprf(MSGCH_ERROR, "Banning ready() after %d throttles",
-                            CLua::MAX_THROTTLE_SLEEPS);
+                        mprf(MSGCH_ERROR,
+                             "Banning ready() after it ran out of time");
                     }
 
                 }
@@ -2700,6 +2708,9 @@ static command_type _get_next_cmd()
 #ifdef DEBUG_MONS_SCAN
     debug_mons_scan();
 #endif
+#ifdef DEBUG
+    debug_opacity_scan();
+#endif
 
     _center_cursor();
 
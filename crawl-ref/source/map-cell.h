@@ -1,5 +1,8 @@
 #pragma once
 
+#include <deque>
+#include <vector>
+
 #include "enum.h"
 #include "mon-info.h"
 #include "tag-version.h"
@@ -56,6 +59,93 @@ struct cloud_info
     killer_type killer;
 };
 
+/*
+ * The clouds, items and monsters that map_cells remember live in these
+ * pools, and cells refer to them by handle. Copying a cell, as the view
+ * buffers and map_forgotten do wholesale, just adds a reference; a payload
+ * is only copied when a cell that shares it wants to change it.
+ *
+ * Slots are never moved, so pointers into a pool stay valid for as long as
+ * the handle they came from is held.
+ */
+template <class T>
+class map_payload_pool
+{
+public:
+    typedef uint32_t handle; // 0 means none
+
+    static map_payload_pool &get()
+    {
+        // Never destroyed, since the global env's cells outlive any static.
+        static map_payload_pool *pool = new map_payload_pool;
+        return *pool;
+    }
+
+    handle add(const T &value)
+    {
+        handle h;
+        if (free_slots.empty())
+        {
+            slots.push_back({value, 1});
+            h = slots.size();
+        }
+        else
+        {
+            h = free_slots.back();
+            free_slots.pop_back();
+            slots[h - 1].value = value;
+            slots[h - 1].refs = 1;
+        }
+        return h;
+    }
+
+    void retain(handle h)
+    {
+        if (h)
+            ++slots[h - 1].refs;
+    }
+
+    void release(handle h)
+    {
+        if (h && !--slots[h - 1].refs)
+            free_slots.push_back(h);
+    }
+
+    T *operator[](handle h)
+    {
+        return h ? &slots[h - 1].value : nullptr;
+    }
+
+    // Get a handle that nothing else refers to, copying the payload if it is
+    // shared, so that it can be changed.
+    handle unshare(handle h)
+    {
+        if (!h || slots[h - 1].refs == 1)
+            return h;
+        --slots[h - 1].refs;
+        return add(slots[h - 1].value);
+    }
+
+    // How many payloads are in use.
+    size_t size() const
+    {
+        return slots.size() - free_slots.size();
+    }
+
+private:
+    struct slot
+    {
+        T value;
+        uint32_t refs;
+    };
+    deque<slot> slots;
+    vector<handle> free_slots;
+};
+
+typedef map_payload_pool<cloud_info> map_cloud_pool;
+typedef map_payload_pool<item_def> map_item_pool;
+typedef map_payload_pool<monster_info> map_monster_pool;
+
 /*
  * A map_cell stores what the player knows about a cell.
  * These go in env.map_knowledge.
@@ -70,41 +160,21 @@ struct map_cell
     map_cell(const map_cell& c)
     {
         memcpy(this, &c, sizeof(map_cell));
-        if (_cloud)
-            _cloud = new cloud_info(*_cloud);
-        if (_mons)
-            _mons = new monster_info(*_mons);
-        if (_item)
-            _item = new item_def(*_item);
+        _retain();
     }
 
     ~map_cell()
     {
-        if (_cloud)
-            delete _cloud;
-        if (!(flags & MAP_DETECTED_MONSTER) && _mons)
-            delete _mons;
-        if (_item)
-            delete _item;
+        _release();
     }
 
     map_cell& operator=(const map_cell& c)
     {
         if (&c == this)
             return *this;
-        if (_cloud)
-            delete _cloud;
-        if (_mons)
-            delete _mons;
-        if (_item)
-            delete _item;
+        c._retain();
+        _release();
         memcpy(this, &c, sizeof(map_cell));
-        if (_cloud)
-            _cloud = new cloud_info(*_cloud);
-        if (_mons)
-            _mons = new monster_info(*_mons);
-        if (_item)
-            _item = new item_def(*_item);
         return *this;
     }
 
@@ -153,9 +223,16 @@ struct map_cell
         _trap = tr;
     }
 
-    item_def* item() const
+    const item_def* item() const
     {
-        return _item;
+        return map_item_pool::get()[_item];
+    }
+
+    // The remembered item, for changing; copied first if it is shared.
+    item_def* edit_item()
+    {
+        _item = map_item_pool::get().unshare(_item);
+        return map_item_pool::get()[_item];
     }
 
     bool detected_item() const
@@ -173,7 +250,7 @@ struct map_cell
     void set_item(const item_def& ii, bool more_items)
     {
         clear_item();
-        _item = new item_def(ii);
+        _item = map_item_pool::get().add(ii);
         if (more_items)
             flags |= MAP_MORE_ITEMS;
     }
@@ -182,31 +259,28 @@ struct map_cell
 
     void clear_item()
     {
-        if (_item)
-        {
-            delete _item;
-            _item = 0;
-        }
+        map_item_pool::get().release(_item);
+        _item = 0;
         flags &= ~(MAP_DETECTED_ITEM | MAP_MORE_ITEMS);
     }
 
     monster_type monster() const
     {
         if (_mons)
-            return _mons->type;
+            return monsterinfo()->type;
         else
             return MONS_NO_MONSTER;
     }
 
-    monster_info* monsterinfo() const
+    const monster_info* monsterinfo() const
     {
-        return _mons;
+        return map_monster_pool::get()[_mons];
     }
 
     void set_monster(const monster_info& mi)
     {
         clear_monster();
-        _mons = new monster_info(mi);
+        _mons = map_monster_pool::get().add(mi);
     }
 
     bool detected_monster() const
@@ -222,8 +296,9 @@ struct map_cell
     void set_detected_monster(monster_type mons)
     {
         clear_monster();
-        _mons = new monster_info(MONS_SENSED);
-        _mons->base_type = mons;
+        monster_info mi(MONS_SENSED);
+        mi.base_type = mons;
+        _mons = map_monster_pool::get().add(mi);
         flags |= MAP_DETECTED_MONSTER;
     }
 
@@ -235,8 +310,7 @@ struct map_cell
 
     void clear_monster()
     {
-        if (_mons)
-            delete _mons;
+        map_monster_pool::get().release(_mons);
         flags &= ~(MAP_DETECTED_MONSTER | MAP_INVISIBLE_MONSTER);
         _mons = 0;
     }
@@ -244,7 +318,7 @@ struct map_cell
     cloud_type cloud() const
     {
         if (_cloud)
-            return _cloud->type;
+            return cloudinfo()->type;
         else
             return CLOUD_NONE;
     }
@@ -252,29 +326,42 @@ struct map_cell
     unsigned cloud_colour() const
     {
         if (_cloud)
-            return _cloud->colour;
+            return cloudinfo()->colour;
         else
             return 0;
     }
 
-    cloud_info* cloudinfo() const
+    const cloud_info* cloudinfo() const
     {
-        return _cloud;
+        return map_cloud_pool::get()[_cloud];
     }
 
     void set_cloud(const cloud_info& ci)
     {
-        if (_cloud)
-            delete _cloud;
-        _cloud = new cloud_info(ci);
+        map_cloud_pool::get().release(_cloud);
+        _cloud = map_cloud_pool::get().add(ci);
     }
 
     void clear_cloud()
     {
+        map_cloud_pool::get().release(_cloud);
+        _cloud = 0;
+    }
+
+    // Move the remembered monster and cloud to gc.
+    void set_payload_pos(const coord_def &gc)
+    {
+        if (_mons)
+        {
+            map_monster_pool &pool = map_monster_pool::get();
+            _mons = pool.unshare(_mons);
+            pool[_mons]->pos = gc;
+        }
         if (_cloud)
         {
-            delete _cloud;
-            _cloud = 0;
+            map_cloud_pool &pool = map_cloud_pool::get();
+            _cloud = pool.unshare(_cloud);
+            pool[_cloud]->pos = gc;
         }
     }
 
@@ -316,7 +403,21 @@ private:
     dungeon_feature_type _feat:8;
     colour_t _feat_colour;
     trap_type _trap:8;
-    cloud_info* _cloud;
-    item_def* _item;
-    monster_info* _mons;
+    map_cloud_pool::handle _cloud;
+    map_item_pool::handle _item;
+    map_monster_pool::handle _mons;
+
+    void _retain() const
+    {
+        map_cloud_pool::get().retain(_cloud);
+        map_item_pool::get().retain(_item);
+        map_monster_pool::get().retain(_mons);
+    }
+
+    void _release()
+    {
+        map_cloud_pool::get().release(_cloud);
+        map_item_pool::get().release(_item);
+        map_monster_pool::get().release(_mons);
+    }
 };
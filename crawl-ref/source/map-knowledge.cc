@@ -167,9 +167,10 @@ void map_cell::set_detected_item()
 {
     clear_item();
     flags |= MAP_DETECTED_ITEM;
-    _item = new item_def();
-    _item->base_type = OBJ_DETECTED;
-    _item->rnd       = 1;
+    item_def detected;
+    detected.base_type = OBJ_DETECTED;
+    detected.rnd       = 1;
+    _item = map_item_pool::get().add(detected);
 }
 
 static bool _floor_mf(map_feature mf)
@@ -304,8 +305,8 @@ bool map_cell::update_cloud_state()
         return false; // we're already up-to-date
 
     // player non-opaque clouds vanish instantly out of los
-    if (_cloud && _cloud->killer == KILL_YOU_MISSILE
-        && !is_opaque_cloud(_cloud->type))
+    if (_cloud && cloudinfo()->killer == KILL_YOU_MISSILE
+        && !is_opaque_cloud(cloudinfo()->type))
     {
         clear_cloud();
         return true;
@@ -13,6 +13,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <unordered_map>
 
 #include "abyss.h"
 #include "artefact.h"
@@ -2173,6 +2174,15 @@ bool depth_ranges::is_usable_in(const level_id &lid) const
     return any_matched;
 }
 
+// Could is_usable_in() be true for some level in the given branch?
+bool depth_ranges::may_match_branch(branch_type br) const
+{
+    for (const level_range &lr : depths)
+        if (!lr.deny && (lr.branch == br || lr.branch == NUM_BRANCHES))
+            return true;
+    return false;
+}
+
 void depth_ranges::add_depths(const depth_ranges &other_depths)
 {
     depths.insert(depths.end(),
@@ -2572,7 +2582,7 @@ string map_def::run_lua(bool run_main)
 {
     dlua_set_map mset(this);
 
-    int err = prelude.load(dlua);
+    int err = prelude.load(dlua, name);
     if (err == E_CHUNK_LOAD_FAILURE)
         lua_pushnil(dlua);
     else if (err)
@@ -2583,7 +2593,7 @@ string map_def::run_lua(bool run_main)
     if (run_main)
     {
         // Run the map chunk to set up the vault's map grid.
-        err = mapchunk.load(dlua);
+        err = mapchunk.load(dlua, name);
         if (err == E_CHUNK_LOAD_FAILURE)
             lua_pushnil(dlua);
         else if (err)
@@ -2598,7 +2608,7 @@ string map_def::run_lua(bool run_main)
 
         // Run the main Lua chunk to set up the rest of the vault
         run_hook("pre_main");
-        err = main.load(dlua);
+        err = main.load(dlua, name);
         if (err == E_CHUNK_LOAD_FAILURE)
             lua_pushnil(dlua);
         else if (err)
@@ -2662,7 +2672,7 @@ bool map_def::test_lua_boolchunk(dlua_chunk &chunk, bool defval,
     bool result = defval;
     dlua_set_map mset(this);
 
-    int err = chunk.load(dlua);
+    int err = chunk.load(dlua, name);
     if (err == E_CHUNK_LOAD_FAILURE)
         return result;
     else if (err)
@@ -2785,9 +2795,9 @@ string map_def::validate_map_placeable()
     // Ok, the map wants to be placed by tag. In this case it should have
     // at least one tag that's not a map flag.
     bool has_selectable_tag = false;
-    for (const string &piece : tags)
+    for (map_tag_id piece : tags)
     {
-        if (_map_tag_is_selectable(piece))
+        if (_map_tag_is_selectable(map_tag_name(piece)))
         {
             has_selectable_tag = true;
             break;
@@ -3330,20 +3340,93 @@ bool map_def::has_all_tags(const string &tagswanted) const
     return has_all_tags(tags_set.begin(), tags_set.end());
 }
 
+// The global tag symbol table. Tags are never removed from it, so ids stay
+// valid even after the maps are reread.
+struct map_tag_table
+{
+    vector<string> names;
+    unordered_map<string, map_tag_id> ids;
+    // For each prefix (or suffix) ever asked about, which tags have it.
+    // Extended as new tags are interned.
+    unordered_map<string, vector<bool>> prefixes;
+    unordered_map<string, vector<bool>> suffixes;
+
+    map_tag_table()
+    {
+        // The tag families the dungeon builder asks about all the time.
+        for (const char *prefix : { "temple_", "uniq_", "chance_" })
+            prefixes[prefix];
+        suffixes["entry"];
+    }
+};
+
+static map_tag_table &_map_tags()
+{
+    static map_tag_table table;
+    return table;
+}
+
+map_tag_id map_tag_intern(const string &tag)
+{
+    map_tag_table &table = _map_tags();
+    auto it = table.ids.emplace(tag, table.names.size());
+    if (it.second)
+    {
+        table.names.push_back(tag);
+        for (auto &prefix : table.prefixes)
+            prefix.second.push_back(starts_with(tag, prefix.first));
+        for (auto &suffix : table.suffixes)
+            suffix.second.push_back(ends_with(tag, suffix.first));
+    }
+    return it.first->second;
+}
+
+map_tag_id map_tag_find(const string &tag)
+{
+    const map_tag_table &table = _map_tags();
+    auto it = table.ids.find(tag);
+    return it == table.ids.end() ? -1 : it->second;
+}
+
+const string &map_tag_name(map_tag_id id)
+{
+    return _map_tags().names[id];
+}
+
+// Which interned tags start (or end) with affix?
+static const vector<bool> &_tags_with_affix(const string &affix, bool prefix)
+{
+    map_tag_table &table = _map_tags();
+    auto &cache = prefix ? table.prefixes : table.suffixes;
+    auto it = cache.find(affix);
+    if (it != cache.end())
+        return it->second;
+
+    vector<bool> &matches = cache[affix];
+    for (const string &name : table.names)
+    {
+        matches.push_back(prefix ? starts_with(name, affix)
+                                 : ends_with(name, affix));
+    }
+    return matches;
+}
+
 bool map_def::has_tag(const string &tagwanted) const
 {
 #ifdef DEBUG_TAG_PROFILING
     _profile_inc_tag(tagwanted);
 #endif
-    return tags.count(tagwanted) > 0;
+    const map_tag_id id = map_tag_find(tagwanted);
+    return id >= 0 && binary_search(tags.begin(), tags.end(), id);
 }
 
 bool map_def::has_tag_prefix(const string &prefix) const
 {
     if (prefix.empty())
         return false;
-    for (const auto &tag : tags)
-        if (starts_with(tag, prefix))
+    const vector<bool> &matches = _tags_with_affix(prefix, true);
+    for (map_tag_id id : tags)
+        if (matches[id])
             return true;
     return false;
 }
@@ -3352,39 +3435,57 @@ bool map_def::has_tag_suffix(const string &suffix) const
 {
     if (suffix.empty())
         return false;
-    for (const auto &tag : tags)
-        if (ends_with(tag, suffix))
+    const vector<bool> &matches = _tags_with_affix(suffix, false);
+    for (map_tag_id id : tags)
+        if (matches[id])
             return true;
     return false;
 }
 
 const unordered_set<string> map_def::get_tags_unsorted() const
 {
-    return tags;
+    unordered_set<string> result;
+    for (map_tag_id id : tags)
+        result.insert(map_tag_name(id));
+    return result;
 }
 
 const vector<string> map_def::get_tags() const
 {
     // this might seem inefficient, but get_tags is not called very much; the
     // hotspot revealed by profiling is actually has_tag checks.
-    vector<string> result(tags.begin(), tags.end());
+    vector<string> result;
+    for (map_tag_id id : tags)
+        result.push_back(map_tag_name(id));
     sort(result.begin(), result.end());
     return result;
 }
 
 void map_def::add_tags(const string &tag)
 {
-    auto parsed_tags = parse_tags(tag);
-    tags.insert(parsed_tags.begin(), parsed_tags.end());
+    for (const string &t : parse_tags(tag))
+    {
+        const map_tag_id id = map_tag_intern(t);
+        auto pos = lower_bound(tags.begin(), tags.end(), id);
+        if (pos == tags.end() || *pos != id)
+            tags.insert(pos, id);
+    }
     update_cached_tags();
 }
 
 bool map_def::remove_tags(const string &tag)
 {
     bool removed = false;
-    auto parsed_tags = parse_tags(tag);
-    for (auto &t : parsed_tags)
-        removed = tags.erase(t) || removed; // would iterator overload be ok?
+    for (const string &t : parse_tags(tag))
+    {
+        const map_tag_id id = map_tag_find(t);
+        auto pos = lower_bound(tags.begin(), tags.end(), id);
+        if (id >= 0 && pos != tags.end() && *pos == id)
+        {
+            tags.erase(pos);
+            removed = true;
+        }
+    }
     update_cached_tags();
     return removed;
 }
@@ -975,6 +975,7 @@ public:
     void clear() { depths.clear(); }
     bool empty() const { return depths.empty(); }
     bool is_usable_in(const level_id &lid) const;
+    bool may_match_branch(branch_type br) const;
     void add_depth(const level_range &range) { depths.push_back(range); }
     void add_depths(const depth_ranges &other_ranges);
     string describe() const;
@@ -1085,6 +1086,14 @@ struct subvault_place
     void set_subvault(const map_def &);
 };
 
+// Map tags are interned: every distinct tag gets a small id that stays
+// valid for the rest of the process, and maps store the ids of their tags.
+typedef int map_tag_id;
+map_tag_id map_tag_intern(const string &tag);
+// Returns -1 if no map has ever had the tag.
+map_tag_id map_tag_find(const string &tag);
+const string &map_tag_name(map_tag_id id);
+
 /////////////////////////////////////////////////////////////////////////////
 // map_def: map definitions for maps loaded from .des files.
 //
@@ -1156,7 +1165,8 @@ public:
     string          file;
 
 private:
-    unordered_set<string>     tags;
+    // Sorted ids of interned tags; see map_tag_intern().
+    vector<map_tag_id>        tags;
     // This map has been loaded from an index, and not fully realised.
     bool            index_only;
     mutable long    cache_offset;
@@ -1288,6 +1298,7 @@ public:
 
     const vector<string> get_tags() const;
     const unordered_set<string> get_tags_unsorted() const;
+    const vector<map_tag_id> &get_tag_ids() const { return tags; }
     void add_tags(const string &tag);
     void set_tags(const string &tag);
     bool remove_tags(const string &tag);
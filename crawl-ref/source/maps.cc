@@ -68,6 +68,89 @@ point_vector map_anchor_points;
 
 static map_vector vdefs;
 
+typedef vector<unsigned> vault_indices;
+
+// An index over vdefs, so that selecting a vault only looks at the maps that
+// could possibly be chosen. It only narrows the search: every candidate is
+// still checked in full, in vdefs order, so the results are unchanged.
+struct vault_index
+{
+    bool built = false;
+    // The maps carrying each interned tag.
+    vector<vault_indices> by_tag;
+    // Maps whose DEPTH or PLACE may include some level of the branch.
+    FixedVector<vault_indices, NUM_BRANCHES> by_depth;
+    FixedVector<vault_indices, NUM_BRANCHES> by_place;
+};
+static vault_index vindex;
+
+// Must be called whenever vdefs, or the tags and depths of its maps, change.
+static void _invalidate_vault_index()
+{
+    vindex = vault_index();
+}
+
+static const vault_index &_vault_index()
+{
+    if (vindex.built)
+        return vindex;
+
+    for (unsigned i = 0, size = vdefs.size(); i < size; ++i)
+    {
+        const map_def &map = vdefs[i];
+        for (map_tag_id tag : map.get_tag_ids())
+        {
+            if (tag >= (int)vindex.by_tag.size())
+                vindex.by_tag.resize(tag + 1);
+            vindex.by_tag[tag].push_back(i);
+        }
+
+        for (branch_iterator it; it; ++it)
+        {
+            if (map.depths.may_match_branch(it->id))
+                vindex.by_depth[it->id].push_back(i);
+            if (map.place.may_match_branch(it->id))
+                vindex.by_place[it->id].push_back(i);
+        }
+    }
+
+    vindex.built = true;
+    return vindex;
+}
+
+// The maps that have all of the given tags, in vdefs order.
+template <typename TagIterator>
+static vault_indices _maps_with_all_tags(TagIterator begin, TagIterator end)
+{
+    const vault_index &index = _vault_index();
+    vector<const vault_indices *> postings;
+    for (; begin != end; ++begin)
+    {
+        const map_tag_id tag = map_tag_find(*begin);
+        if (tag < 0 || tag >= (int)index.by_tag.size())
+            return vault_indices();
+        postings.push_back(&index.by_tag[tag]);
+    }
+    // map_def::has_all_tags() matches nothing for an empty tag list.
+    if (postings.empty())
+        return vault_indices();
+
+    sort(postings.begin(), postings.end(),
+         [](const vault_indices *a, const vault_indices *b)
+         { return a->size() < b->size(); });
+
+    vault_indices maps;
+    for (unsigned i : *postings[0])
+    {
+        bool all = true;
+        for (unsigned j = 1; j < postings.size() && all; ++j)
+            all = binary_search(postings[j]->begin(), postings[j]->end(), i);
+        if (all)
+            maps.push_back(i);
+    }
+    return maps;
+}
+
 // Parameter array that vault code can use.
 string_vector map_parameters;
 
@@ -769,10 +852,10 @@ mapref_vector find_maps_for_tag(const string &tag,
     level_id place = level_id::current();
     unordered_set<string> tag_set = parse_tags(tag);
 
-    for (const map_def &mapdef : vdefs)
+    for (unsigned i : _maps_with_all_tags(tag_set.begin(), tag_set.end()))
     {
-        if (mapdef.has_all_tags(tag_set.begin(), tag_set.end())
-            && !mapdef.has_tag("dummy")
+        const map_def &mapdef = vdefs[i];
+        if (!mapdef.has_tag("dummy")
             && (!check_depth || _debug_ignore_depth
                 || !mapdef.has_depth()
                 || mapdef.is_usable_in(place))
@@ -798,6 +881,7 @@ private:
 public:
     bool accept(const map_def &md) const;
     void announce(const map_def *map) const;
+    const vault_indices &candidates() const;
 
     bool valid() const
     {
@@ -864,6 +948,10 @@ public:
     const maybe_bool extra;
     const bool check_depth;
     const bool check_layout;
+
+private:
+    // Tag selections are an intersection of index lists, built on demand.
+    mutable vault_indices tag_matches;
 };
 
 static bool _overflow_range(level_id place)
@@ -992,7 +1080,27 @@ string vault_chance_tag(const map_def &map)
     return "";
 }
 
-typedef vector<unsigned> vault_indices;
+// The returned list stays valid until the vault index is invalidated, or
+// (for tag selections) the selector goes away.
+const vault_indices &map_selector::candidates() const
+{
+    switch (sel)
+    {
+    case PLACE:
+        return _vault_index().by_place[place.branch];
+    case DEPTH:
+    case DEPTH_AND_CHANCE:
+        return _vault_index().by_depth[place.branch];
+    case TAG:
+    {
+        const unordered_set<string> tag_set = parse_tags(tag);
+        tag_matches = _maps_with_all_tags(tag_set.begin(), tag_set.end());
+        return tag_matches;
+    }
+    default:
+        die("invalid map selector %d", sel);
+    }
+}
 
 static vault_indices _eligible_maps_for_selector(const map_selector &sel)
 {
@@ -1000,7 +1108,7 @@ static vault_indices _eligible_maps_for_selector(const map_selector &sel)
 
     if (sel.valid())
     {
-        for (unsigned i = 0, size = vdefs.size(); i < size; ++i)
+        for (unsigned i : sel.candidates())
             if (sel.accept(vdefs[i]))
                 eligible.push_back(i);
     }
@@ -1360,6 +1468,7 @@ static bool _load_map_index(const string& cache, const string &base,
 
     const int nmaps = unmarshallShort(inf);
     const int nexist = vdefs.size();
+    _invalidate_vault_index();
     vdefs.resize(nexist + nmaps, map_def());
     for (int i = 0; i < nmaps; ++i)
     {
@@ -1547,6 +1656,8 @@ void reread_maps()
 
     // BOOM!
     vdefs.clear();
+    dlua_chunk::clear_cache(dlua);
+    _invalidate_vault_index();
     map_files_read.clear();
     read_maps();
 }
@@ -1566,6 +1677,7 @@ void add_parsed_map(const map_def &md)
 
     map.fixup();
     vdefs.push_back(map);
+    _invalidate_vault_index();
 }
 
 void run_map_global_preludes()
@@ -1582,6 +1694,8 @@ void run_map_global_preludes()
 
 void run_map_local_preludes()
 {
+    // Preludes may change the tags and depths of their maps.
+    _invalidate_vault_index();
     for (map_def &vdef : vdefs)
     {
         if (!vdef.prelude.empty())
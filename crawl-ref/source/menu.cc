@@ -3427,19 +3427,21 @@ void Menu::webtiles_write_item(const MenuEntry* me) const
 int menu_colour(const string &text, const string &prefix, const string &tag, bool strict)
 {
     const string tmp_text = prefix + text;
+    const vector<colour_mapping> &mappings = Options.menu_colour_mappings;
 
-    for (const colour_mapping &cm : Options.menu_colour_mappings)
+    static pattern_set patterns;
+    patterns.update(mappings, [](const colour_mapping &cm)
+                              -> const text_pattern & { return cm.pattern; });
+
+    const int i = patterns.first_match(tmp_text, [&](size_t j)
     {
+        const colour_mapping &cm = mappings[j];
         const bool match_any = !strict &&
             (cm.tag.empty() || cm.tag == "item" || cm.tag == "any");
-        if ((match_any
-                || cm.tag == tag || cm.tag == "inventory" && tag == "pickup")
-            && cm.pattern.matches(tmp_text))
-        {
-            return cm.colour;
-        }
-    }
-    return -1;
+        return match_any
+               || cm.tag == tag || cm.tag == "inventory" && tag == "pickup";
+    });
+    return i >= 0 ? mappings[i].colour : -1;
 }
 
 int MenuHighlighter::entry_colour(const MenuEntry *entry) const
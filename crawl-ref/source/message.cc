@@ -1361,15 +1361,53 @@ void dprf(diag_type param, const char *format, ...)
 
 static bool _updating_view = false;
 
+// The index of the first entry in list whose message_filter (found with
+// filter_of) catches line, skipping entries usable() rejects; or -1.
+// Equivalent to trying message_filter::is_filtered on each entry in turn,
+// but the regexes are run through a pattern_set rebuilt whenever the list
+// changes.
+template <class T, class F, class U>
+static int _first_filter(const string& line, msg_channel_type channel,
+                         const vector<T>& list, pattern_set& patterns,
+                         F filter_of, U usable)
+{
+    patterns.update(list, [&](const T& e) -> const text_pattern&
+                          { return filter_of(e).pattern; });
+
+    auto wanted = [&](size_t i)
+    {
+        const int ch = filter_of(list[i]).channel;
+        return (ch == channel || ch == -1) && usable(list[i]);
+    };
+
+    // An empty pattern catches everything on its channel, and the
+    // pattern_set never matches it.
+    size_t catch_all = 0;
+    while (catch_all < list.size()
+           && !(filter_of(list[catch_all]).pattern.empty()
+                && wanted(catch_all)))
+    {
+        ++catch_all;
+    }
+
+    const int first = patterns.first_match(line, [&](size_t i)
+                                           { return i < catch_all
+                                                    && wanted(i); });
+    if (first >= 0)
+        return first;
+    return catch_all < list.size() ? catch_all : -1;
+}
+
 static bool _check_option(const string& line, msg_channel_type channel,
-                          const vector<message_filter>& option)
+                          const vector<message_filter>& option,
+                          pattern_set& patterns)
 {
     if (crawl_state.generating_level)
         return false;
-    return any_of(begin(option),
-                  end(option),
-                  bind(mem_fn(&message_filter::is_filtered),
-                       placeholders::_1, channel, line));
+    return _first_filter(line, channel, option, patterns,
+                         [](const message_filter& mf) -> const message_filter&
+                         { return mf; },
+                         [](const message_filter&) { return true; }) >= 0;
 }
 
 static bool _check_more(const string& line, msg_channel_type channel)
@@ -1379,7 +1417,8 @@ static bool _check_more(const string& line, msg_channel_type channel)
     // crash here in order to find the real bug?
     if (!you.on_current_level)
         return false;
-    return _check_option(line, channel, Options.force_more_message);
+    static pattern_set patterns;
+    return _check_option(line, channel, Options.force_more_message, patterns);
 }
 
 static bool _check_flash_screen(const string& line, msg_channel_type channel)
@@ -1389,7 +1428,9 @@ static bool _check_flash_screen(const string& line, msg_channel_type channel)
     // crash here in order to find the real bug?
     if (!you.on_current_level)
         return false;
-    return _check_option(line, channel, Options.flash_screen_message);
+    static pattern_set patterns;
+    return _check_option(line, channel, Options.flash_screen_message,
+                         patterns);
 }
 
 static bool _check_join(const string& /*line*/, msg_channel_type channel)
@@ -1773,21 +1814,15 @@ static void mpr_check_patterns(const string& message,
 {
     if (crawl_state.generating_level)
         return;
-    for (const text_pattern &pat : Options.note_messages)
-    {
-        if (channel == MSGCH_EQUIPMENT || channel == MSGCH_FLOOR_ITEMS
-            || channel == MSGCH_MULTITURN_ACTION
-            || channel == MSGCH_EXAMINE || channel == MSGCH_EXAMINE_FILTER
-            || channel == MSGCH_TUTORIAL || channel == MSGCH_DGL_MESSAGE)
-        {
-            continue;
-        }
-
-        if (pat.matches(message))
-        {
+    if (channel != MSGCH_EQUIPMENT && channel != MSGCH_FLOOR_ITEMS
+        && channel != MSGCH_MULTITURN_ACTION
+        && channel != MSGCH_EXAMINE && channel != MSGCH_EXAMINE_FILTER
+        && channel != MSGCH_TUTORIAL && channel != MSGCH_DGL_MESSAGE)
+    {
+        static pattern_set note_patterns;
+        note_patterns.update(Options.note_messages);
+        if (note_patterns.first_match(message) >= 0)
             take_note(Note(NOTE_MESSAGE, channel, param, message));
-            break;
-        }
     }
 
     if (channel != MSGCH_DIAGNOSTICS && channel != MSGCH_EQUIPMENT)
@@ -1833,14 +1868,16 @@ static msg_colour_type prepare_message(const string& imsg,
 
     if (!crawl_state.generating_level)
     {
-        for (const message_colour_mapping &mcm : Options.message_colour_mappings)
-        {
-            if (mcm.valid() && mcm.message.is_filtered(channel, imsg))
-            {
-                colour = mcm.colour;
-                break;
-            }
-        }
+        static pattern_set colour_patterns;
+        const auto &mappings = Options.message_colour_mappings;
+        const int i = _first_filter(imsg, channel, mappings, colour_patterns,
+                          [](const message_colour_mapping &mcm)
+                              -> const message_filter &
+                          { return mcm.message; },
+                          [](const message_colour_mapping &mcm)
+                          { return mcm.valid(); });
+        if (i >= 0)
+            colour = mappings[i].colour;
     }
 
     return colour;
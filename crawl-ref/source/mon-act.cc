@@ -2369,16 +2369,128 @@ static void _post_monster_move(monster* mons)
         monster_die(*mons, KILL_MISC, NON_MONSTER);
 }
 
-priority_queue<pair<monster *, int>,
-               vector<pair<monster *, int> >,
-               MonsterActionQueueCompare> monster_queue;
+/**
+ * Monsters waiting to act, most energetic first.
+ *
+ * An indexed binary heap of monster slots, kept across turns so that energy
+ * changes, births and deaths cost O(log n) rather than a rebuild. Each entry
+ * remembers the energy it was last updated with; if that has changed by the
+ * time it comes up, handle_monsters() updates rather than moves it. Monsters
+ * with equal energy act in slot order, so seeded games stay deterministic.
+ */
+class monster_action_queue
+{
+public:
+    monster_action_queue()
+    {
+        m_pos.fill(-1);
+    }
+
+    bool empty() const { return m_heap.empty(); }
+    size_t size() const { return m_heap.size(); }
+    monster *top() const { return &env.mons[m_heap.front()]; }
+    int top_energy() const { return m_energy[m_heap.front()]; }
+
+    // Insert the monster, or move it to match its current energy.
+    void update(const monster &mons)
+    {
+        const int slot = mons.mindex();
+        if (slot < 0 || slot >= MAX_MONSTERS)
+            return;
+        const int old_energy = m_energy[slot];
+        m_energy[slot] = mons.speed_increment;
+        if (m_pos[slot] < 0)
+        {
+            m_pos[slot] = m_heap.size();
+            m_heap.push_back(slot);
+            _sift_up(m_pos[slot]);
+        }
+        else if (mons.speed_increment > old_energy)
+            _sift_up(m_pos[slot]);
+        else
+            _sift_down(m_pos[slot]);
+    }
+
+    void remove(int slot)
+    {
+        if (slot < 0 || slot >= MAX_MONSTERS || m_pos[slot] < 0)
+            return;
+        const int i = m_pos[slot];
+        m_pos[slot] = -1;
+        const int last = m_heap.back();
+        m_heap.pop_back();
+        if (last == slot)
+            return;
+        _place(i, last);
+        _sift_up(i);
+        _sift_down(m_pos[last]);
+    }
+
+private:
+    // Higher energy acts first; ties go to the lower slot.
+    bool _before(int a, int b) const
+    {
+        return m_energy[a] != m_energy[b] ? m_energy[a] > m_energy[b]
+                                          : a < b;
+    }
+
+    void _place(int i, int slot)
+    {
+        m_heap[i] = slot;
+        m_pos[slot] = i;
+    }
+
+    void _sift_up(int i)
+    {
+        const int slot = m_heap[i];
+        while (i > 0 && _before(slot, m_heap[(i - 1) / 2]))
+        {
+            _place(i, m_heap[(i - 1) / 2]);
+            i = (i - 1) / 2;
+        }
+        _place(i, slot);
+    }
+
+    void _sift_down(int i)
+    {
+        const int n = m_heap.size();
+        const int slot = m_heap[i];
+        while (2 * i + 1 < n)
+        {
+            int child = 2 * i + 1;
+            if (child + 1 < n && _before(m_heap[child + 1], m_heap[child]))
+                ++child;
+            if (!_before(m_heap[child], slot))
+                break;
+            _place(i, m_heap[child]);
+            i = child;
+        }
+        _place(i, slot);
+    }
+
+    vector<int> m_heap;
+    FixedVector<int, MAX_MONSTERS> m_pos;
+    FixedVector<int, MAX_MONSTERS> m_energy;
+};
+
+static monster_action_queue &_monster_queue()
+{
+    static monster_action_queue queue;
+    return queue;
+}
 
 // Inserts a monster into the monster queue (needed to ensure that any monsters
 // given energy or an action by a effect can actually make use of that energy
 // this round)
 void queue_monster_for_action(monster* mons)
 {
-    monster_queue.emplace(mons, mons->speed_increment);
+    _monster_queue().update(*mons);
+}
+
+// Drops a monster slot from the queue when it is reset.
+void unqueue_monster_for_action(int slot)
+{
+    _monster_queue().remove(slot);
 }
 
 static void _clear_monster_flags()
@@ -2387,8 +2499,12 @@ static void _clear_monster_flags()
     // monsters get their actions in the next round.
     // Also clear one-turn deep sleep flag.
     // XXX: MF_JUST_SLEPT only really works for player-cast hibernation.
-    for (auto &mons : menv_real)
-        mons.flags &= ~MF_JUST_SUMMONED & ~MF_JUST_SLEPT;
+    // Slots that aren't in use were reset, and have no flags to clear.
+    for (int i = env.mons_in_use.next(0); i < MAX_MONSTERS;
+         i = env.mons_in_use.next(i + 1))
+    {
+        env.mons[i].flags &= ~MF_JUST_SUMMONED & ~MF_JUST_SLEPT;
+    }
 }
 
 /**
@@ -2453,46 +2569,52 @@ static void _display_just_seen()
  */
 void handle_monsters(bool with_noise)
 {
+    monster_action_queue &queue = _monster_queue();
     for (monster_iterator mi; mi; ++mi)
     {
         _pre_monster_move(**mi);
-        if (!invalid_monster(*mi) && mi->alive() && mi->has_action_energy())
-            monster_queue.emplace(*mi, mi->speed_increment);
+        if (!invalid_monster(*mi) && mi->alive())
+            queue.update(**mi);
         fire_final_effects();
     }
 
     int tries = 0; // infinite loop protection, shouldn't be ever needed
-    while (!monster_queue.empty())
+    while (!queue.empty())
     {
         if (tries++ > 32767)
         {
             die("infinite handle_monsters() loop, mons[0 of %d] is %s",
-                (int)monster_queue.size(),
-                monster_queue.top().first->name(DESC_PLAIN, true).c_str());
+                (int)queue.size(),
+                queue.top()->name(DESC_PLAIN, true).c_str());
         }
 
-        monster *mon = monster_queue.top().first;
-        const int oldspeed = monster_queue.top().second;
-        monster_queue.pop();
+        monster *mon = queue.top();
 
-        if (invalid_monster(mon) || !mon->alive() || !mon->has_action_energy())
+        if (invalid_monster(mon) || !mon->alive())
+        {
+            queue.remove(mon->mindex());
             continue;
+        }
 
-        _update_monster_attitude(mon);
-
-        // Only move the monster if nothing else has played with its energy
-        // during their turn.
-        // If something's played with the energy, they get added back to
-        // the queue just after this.
-        if (oldspeed == mon->speed_increment)
+        // If something has played with the monster's energy since it was
+        // queued, put it back in its proper place before anyone moves.
+        if (queue.top_energy() != mon->speed_increment)
         {
-            handle_monster_move(mon);
-            _post_monster_move(mon);
-            fire_final_effects();
+            queue.update(*mon);
+            continue;
         }
 
-        if (mon->has_action_energy())
-            monster_queue.emplace(mon, mon->speed_increment);
+        // Everyone left is out of energy until next turn.
+        if (!mon->has_action_energy())
+            break;
+
+        _update_monster_attitude(mon);
+        handle_monster_move(mon);
+        _post_monster_move(mon);
+        fire_final_effects();
+
+        if (!invalid_monster(mon) && mon->alive())
+            queue.update(*mon);
 
         // If the player got banished, discard pending monster actions.
         if (you.banished)
@@ -14,15 +14,6 @@ using std::pair;
 class monster;
 struct bolt;
 
-class MonsterActionQueueCompare
-{
-public:
-    bool operator() (pair<monster*, int> m1, pair<monster*, int> m2)
-    {
-        return m1.second < m2.second;
-    }
-};
-
 void mons_set_just_seen(monster *mon);
 void mons_reset_just_seen();
 
@@ -35,3 +26,4 @@ void handle_monsters(bool with_noise = false);
 void handle_monster_move(monster* mon);
 
 void queue_monster_for_action(monster* mons);
+void unqueue_monster_for_action(int slot);
@@ -2418,7 +2418,7 @@ static int _tension_door_closed(set<coord_def> door,
 {
     // this unwind is a bit heavy, but because out-of-los clouds dissipate
     // instantly, they can be wiped out by these door tests.
-    unwind_var<map<coord_def, cloud_struct>> cloud_state(env.cloud);
+    unwind_var<cloud_grid> cloud_state(env.cloud);
     _set_door(door, DNGN_CLOSED_DOOR);
     const int new_tension = get_tension(GOD_NO_GOD);
     _set_door(door, old_feat);
@@ -1580,7 +1580,10 @@ void monster::apply_enchantment(const mon_enchant &me)
                 mprf("The portal closes; %s is severed.", name(DESC_THE).c_str());
 
             if (env.grid(base_position) == DNGN_MALIGN_GATEWAY)
+            {
                 env.grid(base_position) = DNGN_FLOOR;
+                set_terrain_changed(base_position);
+            }
 
             maybe_bloodify_square(base_position);
             add_ench(ENCH_SEVERED);
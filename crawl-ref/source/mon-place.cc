@@ -838,6 +838,7 @@ monster* get_free_monster()
         if (mons.type == MONS_NO_MONSTER)
         {
             mons.reset();
+            env.mons_in_use.add(mons.mindex());
             return &mons;
         }
 
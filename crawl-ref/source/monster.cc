@@ -107,6 +107,13 @@ monster::~monster()
 {
 }
 
+// The index of m in env.mons, or -1 if it isn't one of the real slots.
+static int _env_slot(const monster *m)
+{
+    const monster *base = env.mons.buffer();
+    return m >= base && m < base + MAX_MONSTERS ? m - base : -1;
+}
+
 monster::monster(const monster& mon)
 {
     constricting = 0;
@@ -151,6 +158,12 @@ void monster::reset()
     unseen_pos = coord_def(0, 0);
 
     mons_remove_from_grid(*this);
+    const int slot = _env_slot(this);
+    if (slot >= 0)
+    {
+        env.mons_in_use.remove(slot);
+        unqueue_monster_for_action(slot);
+    }
     target.reset();
     position.reset();
     firing_pos.reset();
@@ -212,6 +225,10 @@ void monster::init_with(const monster& mon)
         ghost.reset(new ghost_demon(*mon.ghost));
     else
         ghost.reset(nullptr);
+
+    const int slot = _env_slot(this);
+    if (slot >= 0 && type != MONS_NO_MONSTER)
+        env.mons_in_use.add(slot);
 }
 
 uint32_t monster::last_client_id = 0;
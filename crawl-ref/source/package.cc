@@ -25,6 +25,8 @@ Notes:
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
+#include <limits>
 #include <sstream>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -32,12 +34,16 @@ Notes:
 #if defined(UNIX) || defined(TARGET_COMPILER_MINGW)
 #include <unistd.h>
 #endif
+#ifdef USE_MMAP
+#include <sys/mman.h>
+#endif
 
 #include "end.h"
 #include "endianness.h"
 #include "errors.h"
 #include "syscalls.h"
 #include "libutil.h" // map_find
+#include "threads.h"
 
 // debugging defines
 #undef  FSCK_VERBOSE
@@ -59,7 +65,7 @@ static plen_t htole(plen_t x)
 #define dprintf(...) do {} while (0)
 #endif
 
-#define PACKAGE_VERSION 1
+#define PACKAGE_VERSION 2
 #define PACKAGE_MAGIC   0x53534344 /* "DCSS" */
 
 struct file_header
@@ -81,11 +87,57 @@ typedef pair<plen_t, plen_t> bm_p;
 typedef map<plen_t, bm_p> bm_t;
 typedef map<plen_t, plen_t> fb_t;
 
+#ifdef USE_ZSTD
+# define DEFAULT_SAVE_CODEC CODEC_ZSTD
+#else
+# define DEFAULT_SAVE_CODEC CODEC_ZLIB
+#endif
+// zstd's level 3 is its own default, and both smaller and faster than zlib's.
+#define ZSTD_SAVE_LEVEL 3
+
+static const char *codec_names[] = { "zlib", "zstd" };
+COMPILE_CHECK(ARRAYSZ(codec_names) == NUM_CODECS);
+
+const char *save_codec_name(save_codec codec)
+{
+    ASSERT(codec < NUM_CODECS);
+    return codec_names[codec];
+}
+
+save_codec str_to_save_codec(const string &name)
+{
+    for (int i = 0; i < NUM_CODECS; ++i)
+        if (name == codec_names[i])
+            return static_cast<save_codec>(i);
+    return NUM_CODECS;
+}
+
+bool save_codec_supported(save_codec codec)
+{
+#ifdef USE_ZSTD
+    if (codec == CODEC_ZSTD)
+        return true;
+#endif
+    return codec == CODEC_ZLIB;
+}
+
+struct package::background_save
+{
+    thread_t thread;
+    vector<queued_chunk> chunks;
+    exception_ptr error;
+};
+
 package::package(const char* file, bool writeable, bool empty)
   : n_users(0), dirty(false), aborted(false)
 #ifdef DO_FSYNC
     , tmp(false)
 #endif
+    , write_codec(DEFAULT_SAVE_CODEC)
+#ifdef USE_MMAP
+    , map_base(nullptr), map_len(0), map_users(0), map_stale(false)
+#endif
+    , bg(nullptr)
 {
     dprintf("package: initializing file=\"%s\" rw=%d\n", file, writeable);
     ASSERT(writeable || !empty);
@@ -136,6 +188,11 @@ package::package()
 #ifdef DO_FSYNC
     , tmp(true)
 #endif
+    , write_codec(DEFAULT_SAVE_CODEC)
+#ifdef USE_MMAP
+    , map_base(nullptr), map_len(0), map_users(0), map_stale(false)
+#endif
+    , bg(nullptr)
 {
     dprintf("package: initializing tmp file\n");
     filename = "[tmp]";
@@ -214,6 +271,13 @@ package::~package()
         // catching missing manual deletes. The C++ exit handler is the
         // only place that can be legitimately call things in wrong order.
 
+#ifdef USE_MMAP
+    // Readers left open by a crash may still be using the mapping; leave it
+    // to go away with the process.
+    if (!map_users)
+        unmap_file();
+#endif
+
     if (rw && !aborted)
     {
         commit();
@@ -232,6 +296,12 @@ package::~package()
 }
 
 void package::commit()
+{
+    wait_for_background();
+    do_commit();
+}
+
+void package::do_commit()
 {
     ASSERT(rw);
     if (!dirty)
@@ -269,6 +339,44 @@ void package::commit()
 #endif
 }
 
+#ifdef USE_MMAP
+// Map the whole file for a new reader, or return nullptr to have it read()
+// instead. A mapping can't be replaced while readers still use it, and
+// isn't trusted to show blocks written after it was made.
+const char *package::map_file()
+{
+    if (map_base && !map_stale)
+        return map_base;
+    if (map_users || fd == -1)
+        return nullptr;
+    unmap_file();
+
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size < (off_t)sizeof(file_header)
+        || (uint64_t)st.st_size > numeric_limits<plen_t>::max())
+    {
+        return nullptr;
+    }
+    void *m = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED)
+        return nullptr;
+
+    map_base = (const char*)m;
+    map_len = st.st_size;
+    map_stale = false;
+    return map_base;
+}
+
+void package::unmap_file()
+{
+    ASSERT(!map_users);
+    if (map_base)
+        munmap((void*)map_base, map_len);
+    map_base = nullptr;
+    map_len = 0;
+}
+#endif
+
 void package::seek(plen_t to)
 {
     ASSERT(!aborted);
@@ -286,8 +394,9 @@ chunk_writer* package::writer(const string &name)
 
 chunk_reader* package::reader(const string &name)
 {
+    wait_for_background();
     if (plen_t *ch = map_find(directory, name))
-        return new chunk_reader(this, *ch);
+        return new chunk_reader(this, *ch, codec_of(name));
     return 0;
 }
 
@@ -359,10 +468,11 @@ plen_t package::alloc_block(plen_t &size)
     return at;
 }
 
-void package::finish_chunk(const string &name, plen_t at)
+void package::finish_chunk(const string &name, plen_t at, save_codec codec)
 {
     free_chunk(name);
     directory[name] = at;
+    chunk_codecs[name] = codec;
     new_chunks.insert(at);
     dirty = true;
 }
@@ -384,13 +494,18 @@ void package::free_chunk(const string &name)
 
 void package::delete_chunk(const string &name)
 {
+    wait_for_background();
     free_chunk(name);
     directory.erase(name);
+    chunk_codecs.erase(name);
 }
 
 plen_t package::write_directory()
 {
-    delete_chunk("");
+    // Not delete_chunk(), which would wait for the background save that may
+    // be running this.
+    free_chunk("");
+    directory.erase("");
 
     stringstream dir;
     for (const auto &entry : directory)
@@ -398,6 +513,8 @@ plen_t package::write_directory()
         uint8_t name_len = entry.first.length();
         dir.write((const char*)&name_len, sizeof(name_len));
         dir.write(&entry.first[0], entry.first.length());
+        const uint8_t codec = codec_of(entry.first);
+        dir.write((const char*)&codec, sizeof(codec));
         plen_t start = htole(entry.second);
         dir.write((const char*)&start, sizeof(plen_t));
     }
@@ -405,7 +522,7 @@ plen_t package::write_directory()
     ASSERT(dir.str().size());
     dprintf("writing directory (%u bytes)\n", (unsigned int)dir.str().size());
     {
-        chunk_writer dch(this, "");
+        chunk_writer dch(this, "", false);
         dch.write(&dir.str()[0], dir.str().size());
     }
 
@@ -540,6 +657,7 @@ void package::read_directory(plen_t start, uint8_t version)
         }
         break;
     case 1:
+    case 2:
         uint8_t name_len;
         plen_t bstart;
         while (plen_t res = rd.read(&name_len, sizeof(name_len)))
@@ -550,9 +668,16 @@ void package::read_directory(plen_t start, uint8_t version)
             chname.resize(name_len);
             if (rd.read(&chname[0], name_len) != name_len)
                 corrupted("save file corrupted -- truncated directory");
+            // Version 1 predates codecs; everything was deflated.
+            uint8_t codec = CODEC_ZLIB;
+            if (version >= 2 && rd.read(&codec, sizeof(codec)) != sizeof(codec))
+                corrupted("save file corrupted -- truncated directory");
+            if (codec >= NUM_CODECS)
+                corrupted("save file corrupted -- unknown codec %u", codec);
             if (rd.read(&bstart, sizeof(bstart)) != sizeof(bstart))
                 corrupted("save file corrupted -- truncated directory");
             directory[chname] = htole(bstart);
+            chunk_codecs[chname] = static_cast<save_codec>(codec);
             dprintf("* %s\n", chname.c_str());
         }
         break;
@@ -564,11 +689,25 @@ void package::read_directory(plen_t start, uint8_t version)
 
 bool package::has_chunk(const string &name)
 {
+    wait_for_background();
     return !name.empty() && directory.count(name);
 }
 
+save_codec package::get_chunk_codec(const string &name)
+{
+    wait_for_background();
+    return codec_of(name);
+}
+
+save_codec package::codec_of(const string &name) const
+{
+    const save_codec *codec = map_find(chunk_codecs, name);
+    return codec ? *codec : CODEC_ZLIB;
+}
+
 vector<string> package::list_chunks()
 {
+    wait_for_background();
     vector<string> list;
     list.reserve(directory.size());
     for (const auto &entry : directory)
@@ -619,9 +758,101 @@ void package::abort()
     // Disable any further operations, allow a shutdown. All errors past
     // this point are ignored (assuming we already failed). All writes since
     // the last commit() are lost.
+    join_background(false);
+    queued.clear();
     aborted = true;
 }
 
+// Take a marshalled chunk off the caller's hands. It is compressed into the
+// file when the package is next used, or on another thread by
+// commit_in_background().
+void package::queue_chunk(const string &name, vector<unsigned char> &data)
+{
+    ASSERT(!aborted);
+    ASSERT(name.length() < MAX_CHUNK_NAME_LENGTH);
+    join_background(true);
+
+    for (queued_chunk &chunk : queued)
+        if (chunk.name == name)
+        {
+            chunk.data.swap(data);
+            return;
+        }
+    queued.push_back(queued_chunk());
+    queued.back().name = name;
+    queued.back().data.swap(data);
+}
+
+// Compress the queued chunks and commit on another thread, so the game can
+// carry on meanwhile. Until wait_for_background() returns, a crash leaves
+// the save as of the previous commit, as it would have mid-commit().
+void package::commit_in_background()
+{
+    ASSERT(rw);
+    join_background(true);
+    if (!dirty && queued.empty())
+        return;
+
+    bg = new background_save;
+    bg->chunks.swap(queued);
+    if (thread_create_joinable(&bg->thread, _background_main, this))
+    {
+        // No thread to be had, so finish the save here.
+        queued.swap(bg->chunks);
+        delete bg;
+        bg = nullptr;
+        commit();
+    }
+}
+
+void *package::_background_main(void *arg)
+{
+    package *pkg = static_cast<package *>(arg);
+    try
+    {
+        pkg->write_queued(pkg->bg->chunks);
+        pkg->do_commit();
+    }
+    catch (...)
+    {
+        pkg->bg->error = current_exception();
+    }
+    return nullptr;
+}
+
+// Every other use of the package goes through here first: finish any
+// background save, reporting its errors, and write out queued chunks.
+void package::wait_for_background()
+{
+    join_background(true);
+    if (!queued.empty())
+        write_queued(queued);
+}
+
+void package::join_background(bool rethrow)
+{
+    if (!bg)
+        return;
+
+    thread_join(bg->thread);
+    exception_ptr error = bg->error;
+    delete bg;
+    bg = nullptr;
+    if (error && rethrow)
+        rethrow_exception(error);
+}
+
+void package::write_queued(vector<queued_chunk> &chunks)
+{
+    for (const queued_chunk &chunk : chunks)
+    {
+        chunk_writer out(this, chunk.name, false);
+        if (!chunk.data.empty())
+            out.write(&chunk.data[0], chunk.data.size());
+    }
+    chunks.clear();
+}
+
 void package::unlink()
 {
     abort();
@@ -633,6 +864,7 @@ void package::unlink()
 // the amount of free space not at the end of file
 plen_t package::get_slack()
 {
+    wait_for_background();
     load_traces();
 
     plen_t slack = 0;
@@ -643,6 +875,7 @@ plen_t package::get_slack()
 
 plen_t package::get_chunk_fragmentation(const string &name)
 {
+    wait_for_background();
     load_traces();
     ASSERT(directory.count(name)); // not has_chunk(), "" is valid
     plen_t frags = 0;
@@ -659,6 +892,7 @@ plen_t package::get_chunk_fragmentation(const string &name)
 
 plen_t package::get_chunk_compressed_length(const string &name)
 {
+    wait_for_background();
     load_traces();
     ASSERT(directory.count(name)); // not has_chunk(), "" is valid
     plen_t len = 0;
@@ -673,10 +907,12 @@ plen_t package::get_chunk_compressed_length(const string &name)
     return len;
 }
 
-chunk_writer::chunk_writer(package *parent, const string &_name)
-    : first_block(0), cur_block(0), block_len(0)
+chunk_writer::chunk_writer(package *parent, const string &_name, bool wait)
+    : first_block(0), cur_block(0), block_len(0), stage_len(0)
 {
     ASSERT(parent);
+    if (wait)
+        parent->wait_for_background();
     ASSERT(!parent->aborted);
 
     // If you need more, please change {read,write}_directory().
@@ -686,19 +922,42 @@ chunk_writer::chunk_writer(package *parent, const string &_name)
     dprintf("chunk_writer(%s): starting\n", _name.c_str());
     pkg = parent;
     pkg->n_users++;
+#ifdef USE_MMAP
+    pkg->map_stale = true;
+#endif
     name = _name;
+    // The directory is always deflated, so that any build can at least tell
+    // what the rest of the save needs.
+    codec = name.empty() ? CODEC_ZLIB : pkg->write_codec;
+    if (!save_codec_supported(codec))
+        fail("this build can't compress saves with %s", save_codec_name(codec));
 
 #ifdef USE_ZLIB
+#define ZB_SIZE 32768
+#ifdef USE_ZSTD
+    if (codec == CODEC_ZSTD)
+    {
+        zcs = ZSTD_createCStream();
+        if (!zcs || ZSTD_isError(ZSTD_initCStream(zcs, ZSTD_SAVE_LEVEL)))
+            fail("save file compression failed during init");
+        z_buffer = (Bytef*)malloc(ZB_SIZE);
+    }
+    else
+    {
+#endif
     zs.data_type = Z_BINARY;
     zs.zalloc    = 0;
     zs.zfree     = 0;
     zs.opaque    = Z_NULL;
     if (deflateInit(&zs, Z_DEFAULT_COMPRESSION))
         fail("save file compression failed during init: %s", zs.msg);
-#define ZB_SIZE 32768
     zs.next_out  = z_buffer = (Bytef*)malloc(ZB_SIZE);
     zs.avail_out = ZB_SIZE;
+#ifdef USE_ZSTD
+    }
 #endif
+#endif
+    stage = (char*)malloc(CHUNK_BUFFER_SIZE);
 }
 
 chunk_writer::~chunk_writer()
@@ -711,13 +970,42 @@ chunk_writer::~chunk_writer()
     {
 #ifdef USE_ZLIB
         // ignore errors, they're not relevant anymore
+#ifdef USE_ZSTD
+        if (codec == CODEC_ZSTD)
+            ZSTD_freeCStream(zcs);
+        else
+#endif
         deflateEnd(&zs);
         free(z_buffer);
 #endif
+        free(stage);
         return;
     }
 
+    flush_stage();
+    free(stage);
+
 #ifdef USE_ZLIB
+#ifdef USE_ZSTD
+    if (codec == CODEC_ZSTD)
+    {
+        size_t left;
+        do
+        {
+            ZSTD_outBuffer out = { z_buffer, ZB_SIZE, 0 };
+            left = ZSTD_endStream(zcs, &out);
+            if (ZSTD_isError(left))
+            {
+                fail("save file compression failed: %s",
+                     ZSTD_getErrorName(left));
+            }
+            raw_write(z_buffer, out.pos);
+        } while (left);
+        ZSTD_freeCStream(zcs);
+    }
+    else
+    {
+#endif
     zs.avail_in = 0;
     int res;
     do
@@ -731,11 +1019,14 @@ chunk_writer::~chunk_writer()
     } while (res != Z_STREAM_END);
     if (deflateEnd(&zs) != Z_OK)
         fail("save file compression failed during clean-up: %s", zs.msg);
+#ifdef USE_ZSTD
+    }
+#endif
     free(z_buffer);
 #endif
     if (cur_block)
         finish_block(0);
-    pkg->finish_chunk(name, first_block);
+    pkg->finish_chunk(name, first_block, codec);
 }
 
 void chunk_writer::raw_write(const void *data, plen_t len)
@@ -777,12 +1068,58 @@ void chunk_writer::finish_block(plen_t next)
     pkg->block_map[cur_block] = bm_p(block_len, next);
 }
 
+// Marshalling mostly writes a byte or a word at a time; gather those up so
+// deflate() and the disk see whole blocks.
 void chunk_writer::write(const void *data, plen_t len)
 {
     ASSERT(data);
     ASSERT(!pkg->aborted);
 
+    if (len <= CHUNK_BUFFER_SIZE - stage_len)
+    {
+        memcpy(stage + stage_len, data, len);
+        stage_len += len;
+        return;
+    }
+
+    flush_stage();
+    if (len < CHUNK_BUFFER_SIZE)
+    {
+        memcpy(stage, data, len);
+        stage_len = len;
+    }
+    else
+        encode(data, len);
+}
+
+void chunk_writer::flush_stage()
+{
+    if (stage_len)
+        encode(stage, stage_len);
+    stage_len = 0;
+}
+
+void chunk_writer::encode(const void *data, plen_t len)
+{
 #ifdef USE_ZLIB
+#ifdef USE_ZSTD
+    if (codec == CODEC_ZSTD)
+    {
+        ZSTD_inBuffer in = { data, len, 0 };
+        while (in.pos < in.size)
+        {
+            ZSTD_outBuffer out = { z_buffer, ZB_SIZE, 0 };
+            const size_t res = ZSTD_compressStream(zcs, &out, &in);
+            if (ZSTD_isError(res))
+            {
+                fail("save file compression failed: %s",
+                     ZSTD_getErrorName(res));
+            }
+            raw_write(z_buffer, out.pos);
+        }
+        return;
+    }
+#endif
     zs.next_in  = (Bytef*)data;
     zs.avail_in = len;
     while (zs.avail_in)
@@ -802,18 +1139,44 @@ void chunk_writer::write(const void *data, plen_t len)
 #endif
 }
 
-void chunk_reader::init(plen_t start)
+void chunk_reader::init(plen_t start, save_codec _codec)
 {
     ASSERT(!pkg->aborted);
+    if (!save_codec_supported(_codec))
+    {
+        fail("this save was compressed with %s, which this build can't read",
+             save_codec_name(_codec));
+    }
     pkg->n_users++;
     pkg->reader_count[start]++;
     first_block = next_block = start;
     block_left = 0;
+    ahead_pos = ahead_len = 0;
+    codec = _codec;
+#ifdef USE_MMAP
+    map = pkg->map_file();
+    if (map)
+        pkg->map_users++;
+#else
+    map = nullptr;
+#endif
 
 #ifdef USE_ZLIB
     if (!start)
         corrupted("save file corrupted -- zlib header missing");
 
+    eof = false;
+#ifdef USE_ZSTD
+    if (codec == CODEC_ZSTD)
+    {
+        zds = ZSTD_createDStream();
+        if (!zds || ZSTD_isError(ZSTD_initDStream(zds)))
+            fail("save file decompression failed during init");
+        zin.src = z_buffer;
+        zin.size = zin.pos = 0;
+        return;
+    }
+#endif
     zs.zalloc    = 0;
     zs.zfree     = 0;
     zs.opaque    = Z_NULL;
@@ -821,16 +1184,15 @@ void chunk_reader::init(plen_t start)
     zs.avail_in  = 0;
     if (inflateInit(&zs))
         fail("save file decompression failed during init: %s", zs.msg);
-    eof = false;
 #endif
 }
 
-chunk_reader::chunk_reader(package *parent, plen_t start)
+chunk_reader::chunk_reader(package *parent, plen_t start, save_codec _codec)
 {
     ASSERT(parent);
     dprintf("chunk_reader[%u]: starting\n", start);
     pkg = parent;
-    init(start);
+    init(start, _codec);
 }
 
 chunk_reader::chunk_reader(package *parent, const string &_name)
@@ -840,7 +1202,7 @@ chunk_reader::chunk_reader(package *parent, const string &_name)
         corrupted("save file corrupted -- chunk \"%s\" missing", _name.c_str());
     dprintf("chunk_reader(%s): starting\n", _name.c_str());
     pkg = parent;
-    init(parent->directory[_name]);
+    init(parent->directory[_name], parent->codec_of(_name));
 }
 
 chunk_reader::~chunk_reader()
@@ -848,8 +1210,17 @@ chunk_reader::~chunk_reader()
     dprintf("chunk_reader: closing\n");
 
 #ifdef USE_ZLIB
+#ifdef USE_ZSTD
+    if (codec == CODEC_ZSTD)
+        ZSTD_freeDStream(zds);
+    else
+#endif
     if (inflateEnd(&zs) != Z_OK)
         fail("save file decompression failed during clean-up: %s", zs.msg);
+#endif
+#ifdef USE_MMAP
+    if (map)
+        pkg->map_users--;
 #endif
     ASSERT(pkg->reader_count[first_block] > 0);
     if (!--pkg->reader_count[first_block])
@@ -858,9 +1229,58 @@ chunk_reader::~chunk_reader()
     pkg->n_users--;
 }
 
+// Point at up to len more bytes of the chunk, inside the mapped file.
+plen_t chunk_reader::map_view(const char **at, plen_t len)
+{
+#ifdef USE_MMAP
+    const plen_t map_len = pkg->map_len;
+    if (!block_left)
+    {
+        if (!next_block)
+            return 0;
+        if (next_block > map_len - sizeof(block_header))
+            corrupted("save file corrupted -- block past eof");
+
+        block_header bl;
+        memcpy(&bl, map + next_block, sizeof(block_header));
+        off = next_block + sizeof(block_header);
+        block_left = htole(bl.len);
+        next_block = htole(bl.next);
+        if (!block_left)
+            corrupted("save file corrupted -- empty block");
+    }
+
+    plen_t s = min(len, block_left);
+    if (s > map_len - off)
+        corrupted("save file corrupted -- block past eof");
+    *at = map + off;
+    off += s;
+    block_left -= s;
+    return s;
+#else
+    UNUSED(at, len);
+    die("no mapping to read from");
+#endif
+}
+
 plen_t chunk_reader::raw_read(void *data, plen_t len)
 {
     void *buf = data;
+    if (map)
+    {
+        while (len)
+        {
+            const char *at;
+            plen_t s = map_view(&at, len);
+            if (!s)
+                break;
+            memcpy(buf, at, s);
+            buf = (char*)buf + s;
+            len -= s;
+        }
+        return (char*)buf - (char*)data;
+    }
+
     while (len)
     {
         if (!block_left)
@@ -904,26 +1324,104 @@ plen_t chunk_reader::raw_read(void *data, plen_t len)
     return (char*)buf - (char*)data;
 }
 
+// Serve small reads from a block decoded ahead of time, rather than calling
+// inflate() for every byte that unmarshalling asks for.
 plen_t chunk_reader::read(void *data, plen_t len)
 {
     ASSERT(data);
     if (pkg->aborted)
         return 0;
 
+    char *out = (char*)data;
+    while (len)
+    {
+        if (ahead_pos == ahead_len)
+        {
+            // Big reads can go straight to the caller.
+            if (len >= CHUNK_BUFFER_SIZE)
+                return out - (char*)data + decode(out, len);
+
+            ahead_pos = 0;
+            ahead_len = decode(ahead, CHUNK_BUFFER_SIZE);
+            if (!ahead_len)
+                break;
+        }
+
+        plen_t s = min(len, ahead_len - ahead_pos);
+        memcpy(out, ahead + ahead_pos, s);
+        ahead_pos += s;
+        out += s;
+        len -= s;
+    }
+    return out - (char*)data;
+}
+
+plen_t chunk_reader::decode(void *data, plen_t len)
+{
 #ifdef USE_ZLIB
     if (!len)
         return 0;
     if (eof)
         return 0;
 
+#ifdef USE_ZSTD
+    if (codec == CODEC_ZSTD)
+    {
+        ZSTD_outBuffer out = { data, len, 0 };
+        while (out.pos < out.size)
+        {
+            if (zin.pos == zin.size)
+            {
+                // Decompress from the mapping in place if there is one.
+                if (map)
+                {
+                    const char *at;
+                    zin.size = map_view(&at, numeric_limits<plen_t>::max());
+                    zin.src = at;
+                }
+                else
+                {
+                    zin.size = raw_read(z_buffer, sizeof(z_buffer));
+                    zin.src = z_buffer;
+                }
+                zin.pos = 0;
+                if (!zin.size)
+                    corrupted("save file corrupted -- block truncated");
+            }
+            const size_t res = ZSTD_decompressStream(zds, &out, &zin);
+            if (ZSTD_isError(res))
+            {
+                corrupted("save file decompression failed: %s",
+                          ZSTD_getErrorName(res));
+            }
+            // The frame is complete and flushed.
+            if (!res)
+            {
+                eof = true;
+                break;
+            }
+        }
+        return out.pos;
+    }
+#endif
     zs.next_out  = (Bytef*)data;
     zs.avail_out = len;
     while (zs.avail_out)
     {
         if (!zs.avail_in)
         {
-            zs.next_in  = z_buffer;
-            zs.avail_in = raw_read(z_buffer, sizeof(z_buffer));
+            if (map)
+            {
+                // inflate() doesn't write to its input.
+                const char *at;
+                zs.avail_in = map_view(&at, numeric_limits<plen_t>::max());
+                zs.next_in  = (Bytef*)at;
+            }
+            else
+            {
+                zs.next_in  = z_buffer;
+                zs.avail_in = raw_read(z_buffer, sizeof(z_buffer));
+            }
             if (!zs.avail_in)
                 corrupted("save file corrupted -- block truncated");
         }
@@ -8,6 +8,9 @@
 #include <vector>
 #ifdef USE_ZLIB
 #include <zlib.h>
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 #endif
 
 using std::map;
@@ -20,10 +23,32 @@ using std::vector;
 #define DO_FSYNC
 #endif
 
+// Where it's available, readers decompress straight out of a read-only
+// mapping of the save rather than seeking to and reading every block.
+#ifdef UNIX
+#define USE_MMAP
+#endif
+
 #define MAX_CHUNK_NAME_LENGTH 255
+// Small writes and reads are gathered into blocks of this size, so zlib and
+// the disk don't see the byte-at-a-time traffic of marshalling.
+#define CHUNK_BUFFER_SIZE 32768
 
 typedef uint32_t plen_t;
 
+// How a chunk is compressed. Each chunk's codec is kept in the directory, so
+// one save may mix them.
+enum save_codec : uint8_t
+{
+    CODEC_ZLIB,
+    CODEC_ZSTD,
+    NUM_CODECS
+};
+
+const char *save_codec_name(save_codec codec);
+save_codec str_to_save_codec(const string &name);
+bool save_codec_supported(save_codec codec);
+
 class package;
 
 class chunk_writer
@@ -34,14 +59,24 @@ private:
     plen_t first_block;
     plen_t cur_block;
     plen_t block_len;
+    save_codec codec;
 #ifdef USE_ZLIB
     z_stream zs;
     Bytef *z_buffer;
+#ifdef USE_ZSTD
+    ZSTD_CStream *zcs;
+#endif
 #endif
+    char *stage;
+    plen_t stage_len;
     void raw_write(const void *data, plen_t len);
     void finish_block(plen_t next);
+    void encode(const void *data, plen_t len);
+    void flush_stage();
+    chunk_writer(package *parent, const string &_name, bool wait);
 public:
-    chunk_writer(package *parent, const string &_name);
+    chunk_writer(package *parent, const string &_name)
+        : chunk_writer(parent, _name, true) {}
     ~chunk_writer();
     void write(const void *data, plen_t len);
     friend class package;
@@ -50,17 +85,29 @@ public:
 class chunk_reader
 {
 private:
-    chunk_reader(package *parent, plen_t start);
-    void init(plen_t start);
+    chunk_reader(package *parent, plen_t start,
+                 save_codec _codec = CODEC_ZLIB);
+    void init(plen_t start, save_codec _codec);
     package *pkg;
     plen_t first_block, next_block;
     plen_t off, block_left;
+    save_codec codec;
 #ifdef USE_ZLIB
     bool eof;
     z_stream zs;
     Bytef z_buffer[32768];
+#ifdef USE_ZSTD
+    ZSTD_DStream *zds;
+    ZSTD_inBuffer zin;
+#endif
 #endif
+    char ahead[CHUNK_BUFFER_SIZE];
+    plen_t ahead_pos, ahead_len;
+    // The package's mapping of the file, or nullptr to use read().
+    const char *map;
+    plen_t map_view(const char **at, plen_t len);
     plen_t raw_read(void *data, plen_t len);
+    plen_t decode(void *data, plen_t len);
 public:
     chunk_reader(package *parent, const string &_name);
     ~chunk_reader();
@@ -78,8 +125,13 @@ public:
     chunk_writer* writer(const string &name);
     chunk_reader* reader(const string &name);
     void commit();
+    void queue_chunk(const string &name, vector<unsigned char> &data);
+    void commit_in_background();
+    void wait_for_background();
     void delete_chunk(const string &name);
     bool has_chunk(const string &name);
+    save_codec get_chunk_codec(const string &name);
+    void set_codec(save_codec codec) { write_codec = codec; }
     vector<string> list_chunks();
     void abort();
     void unlink();
@@ -102,14 +154,42 @@ private:
     bool tmp;
 #endif
     map<string, plen_t> directory;
+    map<string, save_codec> chunk_codecs;
+    save_codec write_codec;
     map<plen_t, plen_t> free_blocks;
     vector<plen_t> unlinked_blocks;
     map<plen_t, pair<plen_t, plen_t> > block_map;
     set<plen_t> new_chunks;
     map<plen_t, uint32_t> reader_count;
+#ifdef USE_MMAP
+    const char *map_base;
+    plen_t map_len;
+    int map_users;
+    // Set once blocks are written that the mapping may not show.
+    bool map_stale;
+    const char *map_file();
+    void unmap_file();
+#endif
+
+    struct queued_chunk
+    {
+        string name;
+        vector<unsigned char> data;
+    };
+    // Chunks marshalled but not yet compressed into the file.
+    vector<queued_chunk> queued;
+    // A save being finished on another thread; while it runs, only that
+    // thread may touch the package.
+    struct background_save;
+    background_save *bg;
+    static void *_background_main(void *pkg);
+    void join_background(bool rethrow);
+    void write_queued(vector<queued_chunk> &chunks);
+    void do_commit();
     plen_t extend_block(plen_t at, plen_t size, plen_t by);
     plen_t alloc_block(plen_t &size);
-    void finish_chunk(const string &name, plen_t at);
+    void finish_chunk(const string &name, plen_t at, save_codec codec);
+    save_codec codec_of(const string &name) const;
     void free_chunk(const string &name);
     plen_t write_directory();
     void collect_blocks();
@@ -62,6 +62,38 @@ static pattern_match _pattern_match_location(void *compiled_pattern,
         return pattern_match::failed(string(text));
 }
 
+static int _pattern_groups(void *compiled_pattern)
+{
+    int groups = 0;
+    if (pcre_fullinfo(static_cast<pcre *>(compiled_pattern), nullptr,
+                      PCRE_INFO_CAPTURECOUNT, &groups))
+    {
+        return -1;
+    }
+    return groups;
+}
+
+// Fill starts[g] with the start of capture group g, or -1 if the group
+// didn't take part in the match.
+static bool _pattern_match_groups(void *compiled_pattern, int groups,
+                                  const char *text, int length,
+                                  vector<int> &starts)
+{
+    vector<int> ovector((groups + 1) * 3);
+    int pcre_rc = pcre_exec(static_cast<pcre *>(compiled_pattern),
+                            nullptr,
+                            text, length, 0, 0,
+                            ovector.data(), ovector.size());
+    if (pcre_rc < 0)
+        return false;
+
+    // pcre_rc is one past the highest group that was set.
+    starts.assign(groups + 1, -1);
+    for (int g = 0; g < pcre_rc && g <= groups; ++g)
+        starts[g] = ovector[g * 2];
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////
 #else
 ////////////////////////////////////////////////////////////////////
@@ -115,6 +147,27 @@ static pattern_match _pattern_match_location(void *compiled_pattern,
         return pattern_match::failed(string(text));
 }
 
+static int _pattern_groups(void *compiled_pattern)
+{
+    return static_cast<regex_t *>(compiled_pattern)->re_nsub;
+}
+
+static bool _pattern_match_groups(void *compiled_pattern, int groups,
+                                  const char *text, int length,
+                                  vector<int> &starts)
+{
+    UNUSED(length);
+    vector<regmatch_t> match(groups + 1);
+    regex_t *re = static_cast<regex_t *>(compiled_pattern);
+    if (regexec(re, text, match.size(), match.data(), 0))
+        return false;
+
+    starts.resize(groups + 1);
+    for (int g = 0; g <= groups; ++g)
+        starts[g] = match[g].rm_so;
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////
 #endif
 
@@ -229,3 +282,193 @@ pattern_match plaintext_pattern::match_location(const string &s) const
     else
         return pattern_match::failed(s);
 }
+
+////////////////////////////////////////////////////////////////////
+// pattern_set
+
+pattern_set::~pattern_set()
+{
+    clear();
+}
+
+void pattern_set::clear()
+{
+    for (combined_pattern &cp : combined)
+        _free_compiled_pattern(cp.compiled);
+    combined.clear();
+    loose.clear();
+    patterns.clear();
+}
+
+// Can this pattern be wrapped in a group and joined to others without
+// changing what it, or they, match? Backreferences, recursion and
+// conditions on a group name groups by number, which would now be off; \Q,
+// (* verbs and (?x) comments can run past the end of the wrapping group.
+static bool _combinable(const string &pat)
+{
+    for (size_t i = 0; i + 1 < pat.size(); ++i)
+    {
+        const char c = pat[i], next = pat[i + 1];
+        if (c == '\\')
+        {
+            if ((isadigit(next) && next != '0') || next == 'g' || next == 'Q')
+                return false;
+            ++i;
+        }
+        else if (c == '(' && next == '*')
+            return false;
+        else if (c == '(' && next == '?' && i + 2 < pat.size())
+        {
+            const char opt = pat[i + 2];
+            if (isadigit(opt) || opt == '+' || opt == '-' || opt == 'R'
+                || opt == 'x' || opt == '^')
+            {
+                return false;
+            }
+            // Conditions like (?(1)...), (?(-1)...) or (?(R2)...).
+            if (opt == '(' && i + 3 < pat.size())
+            {
+                const char cond = pat[i + 3];
+                if (isadigit(cond) || cond == '+' || cond == '-'
+                    || cond == 'R')
+                {
+                    return false;
+                }
+            }
+            // Inline options like (?ix) or (?i-x:...).
+            for (size_t j = i + 2; j < pat.size() && isalpha(pat[j]); ++j)
+                if (pat[j] == 'x')
+                    return false;
+        }
+    }
+    return true;
+}
+
+void pattern_set::assign(const vector<text_pattern> &pats)
+{
+    clear();
+    patterns = pats;
+
+    vector<size_t> by_case[2];
+    for (size_t i = 0; i < patterns.size(); ++i)
+    {
+        // Invalid and empty patterns never match, so leave them out
+        // entirely.
+        if (!patterns[i].valid())
+            continue;
+        if (_combinable(patterns[i].tostring()))
+            by_case[patterns[i].caseless()].push_back(i);
+        else
+            loose.push_back(i);
+    }
+
+    combine(by_case[0], false);
+    combine(by_case[1], true);
+    sort(loose.begin(), loose.end());
+}
+
+void pattern_set::combine(const vector<size_t> &rules, bool icase)
+{
+    if (rules.empty())
+        return;
+
+    combined_pattern cp;
+    cp.groups = 0;
+    cp.rule_of_group.push_back(-1);
+    string alternation;
+    for (size_t rule : rules)
+    {
+        const text_pattern &tp = patterns[rule];
+        if (!alternation.empty())
+            alternation += '|';
+        alternation += "(" + tp.tostring() + ")";
+
+        const int inner = _pattern_groups(tp.compiled_pattern);
+        cp.rule_of_group.push_back(rule);
+        cp.rule_of_group.insert(cp.rule_of_group.end(), max(inner, 0), -1);
+        cp.groups += 1 + max(inner, 0);
+    }
+
+    cp.compiled = _compile_pattern(alternation.c_str(), icase);
+    if (cp.compiled && _pattern_groups(cp.compiled) == cp.groups)
+    {
+        combined.push_back(std::move(cp));
+        return;
+    }
+
+    // The regex engine disagreed about the joined pattern (too big, or a
+    // construct _combinable didn't catch): try these rules one at a time.
+    if (cp.compiled)
+        _free_compiled_pattern(cp.compiled);
+    loose.insert(loose.end(), rules.begin(), rules.end());
+}
+
+// Work out which rules are already known to match or not match s. Rules in
+// a combined pattern that found nothing can't match; for one that did, the
+// rule owning the first group that took part is a match and the rest are
+// still unknown.
+void pattern_set::find_candidates(const char *s, int length,
+                                  vector<rule_state> &state) const
+{
+    state.assign(patterns.size(), RULE_FAILED);
+    for (size_t rule : loose)
+        state[rule] = RULE_UNKNOWN;
+
+    vector<int> starts;
+    for (const combined_pattern &cp : combined)
+    {
+        if (!_pattern_match_groups(cp.compiled, cp.groups, s, length, starts))
+            continue;
+
+        bool found = false;
+        for (int g = 1; g <= cp.groups; ++g)
+        {
+            const int rule = cp.rule_of_group[g];
+            if (rule < 0)
+                continue;
+            if (!found && starts[g] >= 0)
+            {
+                state[rule] = RULE_MATCHED;
+                found = true;
+            }
+            else
+                state[rule] = RULE_UNKNOWN;
+        }
+    }
+}
+
+int pattern_set::scan(const string &s, function<bool(size_t)> accept,
+                      vector<size_t> *all) const
+{
+    if (patterns.empty())
+        return -1;
+
+    vector<rule_state> state;
+    find_candidates(s.c_str(), s.length(), state);
+
+    for (size_t i = 0; i < patterns.size(); ++i)
+    {
+        if (state[i] == RULE_FAILED || (accept && !accept(i)))
+            continue;
+        if (state[i] == RULE_MATCHED || patterns[i].matches(s))
+        {
+            if (!all)
+                return i;
+            all->push_back(i);
+        }
+    }
+    return -1;
+}
+
+int pattern_set::first_match(const string &s,
+                             function<bool(size_t)> accept) const
+{
+    return scan(s, accept, nullptr);
+}
+
+vector<size_t> pattern_set::all_matches(const string &s) const
+{
+    vector<size_t> matches;
+    scan(s, nullptr, &matches);
+    return matches;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 class pattern_match
 {
 public:
@@ -116,11 +118,92 @@ public:
         return pattern;
     }
 
+    bool caseless() const { return ignore_case; }
+
 private:
     string pattern;
     mutable void *compiled_pattern;
     mutable bool isvalid;
     bool ignore_case;
+
+    friend class pattern_set;
+};
+
+// An ordered list of rules (force_more_message, note_messages, ...) matched
+// as a whole. The rules are folded into one alternation per case mode, so a
+// string that matches none of them costs a single regex search; when one
+// does match, the capture groups say which rule hit and only the rules
+// that could still precede it are tried one by one. Rules that can't be
+// safely combined (backreferences and similar) are always tried on their
+// own.
+class pattern_set
+{
+public:
+    pattern_set() { }
+    pattern_set(const vector<text_pattern> &pats) { assign(pats); }
+    ~pattern_set();
+
+    pattern_set(const pattern_set &) = delete;
+    pattern_set &operator= (const pattern_set &) = delete;
+
+    void assign(const vector<text_pattern> &pats);
+
+    // Rebuild from an option list if its patterns have changed since the
+    // last call. pattern_of maps a list entry to its text_pattern.
+    template <class T, class P>
+    void update(const vector<T> &list, P pattern_of)
+    {
+        if (list.size() == patterns.size()
+            && equal(list.begin(), list.end(), patterns.begin(),
+                     [&](const T &e, const text_pattern &tp)
+                     { return pattern_of(e) == tp; }))
+        {
+            return;
+        }
+
+        vector<text_pattern> pats;
+        pats.reserve(list.size());
+        for (const T &e : list)
+            pats.push_back(pattern_of(e));
+        assign(pats);
+    }
+
+    void update(const vector<text_pattern> &list)
+    {
+        update(list, [](const text_pattern &tp) -> const text_pattern &
+                     { return tp; });
+    }
+
+    size_t size() const { return patterns.size(); }
+
+    // The index of the first rule that matches s and is accepted by the
+    // (optional) filter, or -1 if there is none.
+    int first_match(const string &s,
+                    function<bool(size_t)> accept = nullptr) const;
+
+    // The indices of every rule that matches s, in order.
+    vector<size_t> all_matches(const string &s) const;
+
+private:
+    struct combined_pattern
+    {
+        void *compiled;
+        int groups;
+        vector<int> rule_of_group; // -1 for a group inside some rule
+    };
+
+    enum rule_state { RULE_UNKNOWN, RULE_MATCHED, RULE_FAILED };
+
+    void clear();
+    void combine(const vector<size_t> &rules, bool icase);
+    void find_candidates(const char *s, int length,
+                         vector<rule_state> &state) const;
+    int scan(const string &s, function<bool(size_t)> accept,
+             vector<size_t> *all) const;
+
+    vector<text_pattern> patterns;
+    vector<combined_pattern> combined;
+    vector<size_t> loose; // rules that are always tried individually
 };
 
 class plaintext_pattern : public base_pattern
@@ -0,0 +1,32 @@
+-- Time saving and loading a save the size of a late game one: a level
+-- stored once for each visited level, plus the stash, travel, note and
+-- message chunks. Run before and after changes to marshalling or the
+-- package format to compare the throughput:
+--   ./crawl -script save_throughput [<place> ...]
+
+local LEVELS = 60
+
+local function time_save(place)
+  debug.goto_place(place)
+  debug.flush_map_memory()
+  debug.generate_level()
+
+  local save_ms, load_ms, bytes = debug.save_throughput(LEVELS)
+  assert(bytes > 0, place .. ": nothing was read back from the save")
+  local mb = bytes / (1024 * 1024)
+  crawl.stderr(string.format("save throughput, %s x%d (%.1f MB): "
+                             .. "save %.1f ms (%.1f MB/s), "
+                             .. "load %.1f ms (%.1f MB/s)",
+                             place, LEVELS, mb,
+                             save_ms, mb / (save_ms / 1000),
+                             load_ms, mb / (load_ms / 1000)))
+end
+
+local places = script.simple_args()
+if #places == 0 then
+  places = { "Depths:3", "Vaults:4" }
+end
+
+for _, place in ipairs(places) do
+  time_save(place)
+end
@@ -869,6 +869,7 @@ spret cast_tomb(int pow, actor* victim, int source, bool fail)
             {
                 ptrap->destroy();
                 env.grid(*ai) = DNGN_FLOOR;
+                set_terrain_changed(*ai);
             }
 
             // Actually place the wall.
@@ -301,7 +301,10 @@ void wizard_blink()
     // Allow wizard blink to send player into walls, in case the
     // user wants to alter that grid to something else.
     if (cell_is_solid(beam.target))
+    {
         env.grid(beam.target) = DNGN_FLOOR;
+        set_terrain_changed(beam.target);
+    }
 
     move_player_to_grid(beam.target, false);
 }
@@ -51,7 +51,8 @@ game_state::game_state()
       throttle(false),
       bypassed_startup_menu(false),
 #endif
-      clua_max_memory_mb(16), show_more_prompt(true),
+      clua_max_memory_mb(16), clua_max_time_ms({{"", 250}}),
+      clua_profile(false), show_more_prompt(true),
       skip_autofight_check(false), terminal_resize_handler(nullptr),
       terminal_resize_check(nullptr), doing_prev_cmd_again(false),
       prev_cmd(CMD_NO_CMD), repeat_cmd(CMD_NO_CMD),
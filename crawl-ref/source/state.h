@@ -100,6 +100,15 @@ struct game_state
      */
     uint64_t clua_max_memory_mb;
 
+    /** The CPU time, in milliseconds, that one top-level call into the
+     * user-script Lua interpreter may use before the script is killed,
+     * by the name of the function or hook called. The "" entry applies to
+     * everything else; 0 means no limit. Only enforced when throttling.
+     */
+    std::map<string, int> clua_max_time_ms;
+
+    bool clua_profile;      // Log user-script Lua CPU time at game end.
+
     bool show_more_prompt;  // Set to false to disable --more-- prompts.
 
     bool skip_autofight_check; // XXX EVIL HACK
@@ -22,6 +22,7 @@
 # include <sys/types.h>
 # include <sys/stat.h>
 #endif
+#include <ctime>
 
 #include "files.h"
 #include "random.h"
@@ -143,6 +144,31 @@ bool read_urandom(char *buf, int len)
 #endif
 }
 
+// CPU time used by the calling thread, in milliseconds; other threads, such
+// as one finishing a save, aren't counted. Falls back to the whole
+// process's time where there's no way to tell threads apart.
+double thread_cpu_ms()
+{
+#ifdef TARGET_OS_WINDOWS
+    FILETIME created, exited, kernel, user;
+    if (GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user))
+    {
+        ULARGE_INTEGER k, u;
+        k.LowPart = kernel.dwLowDateTime;
+        k.HighPart = kernel.dwHighDateTime;
+        u.LowPart = user.dwLowDateTime;
+        u.HighPart = user.dwHighDateTime;
+        // In units of 100ns.
+        return (k.QuadPart + u.QuadPart) / 10000.0;
+    }
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#endif
+    return clock() * 1000.0 / CLOCKS_PER_SEC;
+}
+
 #ifdef TARGET_OS_WINDOWS
 # ifndef UNIX
 // should check the presence of alarm() instead
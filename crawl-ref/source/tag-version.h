@@ -305,6 +305,7 @@ enum tag_minor_version
     TAG_MINOR_TALISMANS_SEEN,      // Keep track of seen talismans
     TAG_MINOR_FIX_APOSTLE_DAMAGE,  // Fix damage tracking of banished apostles
     TAG_MINOR_MON_AURA_REFACTORING,// Mark enchantments from passive auras in mon_enchant
+    TAG_MINOR_COLUMNAR_LEVEL,      // Store level grids a plane at a time
 #endif
     NUM_TAG_MINORS,
     TAG_MINOR_VERSION = NUM_TAG_MINORS - 1
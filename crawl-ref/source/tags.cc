@@ -787,17 +787,19 @@ static void _unmarshall_constriction(reader &th, actor *who)
 #endif
 }
 
-template <typename marshall, typename grid>
-static void _run_length_encode(writer &th, marshall m, const grid &g,
-                               int width, int height)
+// Run-length encode the values get(x, y) returns, row by row.
+template <typename marshall, typename getter>
+static void _run_length_encode_by(writer &th, marshall m, getter get,
+                                  int width, int height)
 {
-    int last = 0, nlast = 0;
+    decltype(get(0, 0)) last{};
+    int nlast = 0;
     for (int y = 0; y < height; ++y)
         for (int x = 0; x < width; ++x)
         {
             if (!nlast)
-                last = g[x][y];
-            if (last == g[x][y] && nlast < 255)
+                last = get(x, y);
+            if (last == get(x, y) && nlast < 255)
             {
                 nlast++;
                 continue;
@@ -806,7 +808,7 @@ static void _run_length_encode(writer &th, marshall m, const grid &g,
             marshallByte(th, nlast);
             m(th, last);
 
-            last = g[x][y];
+            last = get(x, y);
             nlast = 1;
         }
 
@@ -814,27 +816,44 @@ static void _run_length_encode(writer &th, marshall m, const grid &g,
     m(th, last);
 }
 
-template <typename unmarshall, typename grid>
-static void _run_length_decode(reader &th, unmarshall um, grid &g,
-                               int width, int height)
+// Decode what _run_length_encode_by() wrote, calling set(x, y, value) for
+// each cell.
+template <typename unmarshall, typename setter>
+static void _run_length_decode_by(reader &th, unmarshall um, setter set,
+                                  int width, int height)
 {
     const int end = width * height;
     int offset = 0;
     while (offset < end)
     {
         const int run = unmarshallUByte(th);
-        const int value = um(th);
+        const auto value = um(th);
 
-        for (int i = 0; i < run; ++i)
+        for (int i = 0; i < run && offset < end; ++i)
         {
-            const int y = offset / width;
-            const int x = offset % width;
-            g[x][y] = value;
+            set(offset % width, offset / width, value);
             ++offset;
         }
     }
 }
 
+template <typename marshall, typename grid>
+static void _run_length_encode(writer &th, marshall m, const grid &g,
+                               int width, int height)
+{
+    _run_length_encode_by(th, m, [&g](int x, int y) -> int { return g[x][y]; },
+                          width, height);
+}
+
+template <typename unmarshall, typename grid>
+static void _run_length_decode(reader &th, unmarshall um, grid &g,
+                               int width, int height)
+{
+    _run_length_decode_by(th, um,
+                          [&g](int x, int y, int value) { g[x][y] = value; },
+                          width, height);
+}
+
 union float_marshall_kludge
 {
     float    f_num;
@@ -5020,6 +5039,79 @@ static int _last_used_index(const Z &thinglist, int max_things)
 
 // ------------------------------- level tags ---------------------------- //
 
+// Does this cell remember anything beyond its flags and feature?
+static bool _map_cell_has_details(const map_cell &cell)
+{
+    return cell.feat_colour() || feat_is_trap(cell.feat())
+           || cell.cloud() != CLOUD_NONE || cell.item()
+           || cell.monster() != MONS_NO_MONSTER;
+}
+
+// Map knowledge is stored a plane at a time: the flags and the features of
+// every cell as run-length encoded columns, then in full only those cells
+// that also remember a colour, trap, cloud, item or monster.
+static void _marshall_map_knowledge(writer &th, const MapKnowledge &map)
+{
+    _run_length_encode_by(th, marshallUnsigned,
+                          [&map](int x, int y) { return map[x][y].flags; },
+                          GXM, GYM);
+    _run_length_encode_by(th, marshallUByte,
+                          [&map](int x, int y) { return map[x][y].feat(); },
+                          GXM, GYM);
+
+    vector<int> details;
+    for (int y = 0; y < GYM; ++y)
+        for (int x = 0; x < GXM; ++x)
+            if (_map_cell_has_details(map[x][y]))
+                details.push_back(y * GXM + x);
+
+    marshallUnsigned(th, details.size());
+    int last = 0;
+    for (int offset : details)
+    {
+        marshallUnsigned(th, offset - last);
+        marshallMapCell(th, map[offset % GXM][offset / GXM]);
+        last = offset;
+    }
+}
+
+static void _unmarshall_map_knowledge(reader &th, MapKnowledge &map)
+{
+    _run_length_decode_by(th,
+        [](reader &r) { return static_cast<uint32_t>(unmarshallUnsigned(r)); },
+        [&map](int x, int y, uint32_t flags)
+        {
+            map[x][y].clear();
+            map[x][y].flags = flags;
+        }, GXM, GYM);
+    _run_length_decode_by(th, unmarshallFeatureType,
+        [&map](int x, int y, dungeon_feature_type feat)
+        {
+            map[x][y].set_feature(feat);
+        }, GXM, GYM);
+
+    const int count = unmarshallUnsigned(th);
+    int offset = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        offset += unmarshallUnsigned(th);
+        ASSERT(offset < GXM * GYM);
+        unmarshallMapCell(th, map[offset % GXM][offset / GXM]);
+    }
+}
+
+// The terrain, pgrid flags and map knowledge of the current level.
+void marshall_level_planes(writer &th)
+{
+    // Each plane is a column of its own, so that long runs of rock, unseen
+    // cells and unset flags compress down to a few bytes.
+    _run_length_encode(th, marshallUByte, env.grid, GXM, GYM);
+    _run_length_encode_by(th, marshallUnsigned,
+        [](int x, int y) { return uint32_t(env.pgrid[x][y].flags); },
+        GXM, GYM);
+    _marshall_map_knowledge(th, env.map_knowledge);
+}
+
 static void _tag_construct_level(writer &th)
 {
     marshallByte(th, env.floor_colour);
@@ -5038,19 +5130,11 @@ static void _tag_construct_level(writer &th)
 
     CANARY;
 
-    for (int count_x = 0; count_x < GXM; count_x++)
-        for (int count_y = 0; count_y < GYM; count_y++)
-        {
-            marshallByte(th, env.grid[count_x][count_y]);
-            marshallMapCell(th, env.map_knowledge[count_x][count_y]);
-            marshallInt(th, env.pgrid[count_x][count_y].flags);
-        }
+    marshall_level_planes(th);
 
     marshallBoolean(th, !!env.map_forgotten);
     if (env.map_forgotten)
-        for (int x = 0; x < GXM; x++)
-            for (int y = 0; y < GYM; y++)
-                marshallMapCell(th, (*env.map_forgotten)[x][y]);
+        _marshall_map_knowledge(th, *env.map_forgotten);
 
     _run_length_encode(th, marshallByte, env.grid_colours, GXM, GYM);
 
@@ -5058,9 +5142,9 @@ static void _tag_construct_level(writer &th)
 
     // how many clouds?
     marshallShort(th, env.cloud.size());
-    for (const auto& entry : env.cloud)
+    for (const coord_def &pos : env.cloud.positions())
     {
-        const cloud_struct& cloud = entry.second;
+        const cloud_struct& cloud = *env.cloud.find(pos);
         marshallByte(th, cloud.type);
         ASSERT(cloud.type != CLOUD_NONE);
         ASSERT_IN_BOUNDS(cloud.pos);
@@ -5094,11 +5178,7 @@ static void _tag_construct_level(writer &th)
     // Save heightmap, if present.
     marshallByte(th, !!env.heightmap);
     if (env.heightmap)
-    {
-        grid_heightmap &heightmap(*env.heightmap);
-        for (rectangle_iterator ri(0); ri; ++ri)
-            marshallShort(th, heightmap(*ri));
-    }
+        _run_length_encode(th, marshallShort, *env.heightmap, GXM, GYM);
 
     CANARY;
 
@@ -5864,7 +5944,7 @@ void marshallMapCell(writer &th, const map_cell &cell)
 
     if (flags & MAP_SERIALIZE_CLOUD)
     {
-        cloud_info* ci = cell.cloudinfo();
+        const cloud_info* ci = cell.cloudinfo();
         marshallUnsigned(th, ci->type);
         marshallUnsigned(th, ci->colour);
         marshallUnsigned(th, ci->duration);
@@ -6556,6 +6636,36 @@ void _tag_construct_level_tiles(writer &th)
     marshallInt(th, TILE_WALL_MAX);
 }
 
+void unmarshall_level_planes(reader &th)
+{
+#if TAG_MAJOR_VERSION == 34
+    if (th.getMinorVersion() < TAG_MINOR_COLUMNAR_LEVEL)
+    {
+        for (int i = 0; i < GXM; i++)
+            for (int j = 0; j < GYM; j++)
+            {
+                dungeon_feature_type feat = unmarshallFeatureType(th);
+                env.grid[i][j] = feat;
+                ASSERT(feat < NUM_FEATURES);
+                unmarshallMapCell(th, env.map_knowledge[i][j]);
+                env.pgrid[i][j].flags = unmarshallInt(th);
+            }
+        return;
+    }
+#endif
+    _run_length_decode_by(th, unmarshallFeatureType,
+        [](int x, int y, dungeon_feature_type feat)
+        {
+            ASSERT(feat < NUM_FEATURES);
+            env.grid[x][y] = feat;
+        }, GXM, GYM);
+    _run_length_decode_by(th,
+        [](reader &r) { return static_cast<uint32_t>(unmarshallUnsigned(r)); },
+        [](int x, int y, uint32_t flags) { env.pgrid[x][y].flags = flags; },
+        GXM, GYM);
+    _unmarshall_map_knowledge(th, env.map_knowledge);
+}
+
 static void _tag_read_level(reader &th)
 {
     env.floor_colour = unmarshallUByte(th);
@@ -6583,32 +6693,28 @@ static void _tag_read_level(reader &th)
     EAT_CANARY;
 
     env.map_seen.reset();
+    unmarshall_level_planes(th);
 #if TAG_MAJOR_VERSION == 34
+    // Save these for potential destination clean up.
     vector<coord_def> transporters;
+    if (th.getMinorVersion() < TAG_MINOR_TRANSPORTER_LANDING)
+    {
+        for (int i = 0; i < gx; i++)
+            for (int j = 0; j < gy; j++)
+                if (env.grid[i][j] == DNGN_TRANSPORTER)
+                    transporters.push_back(coord_def(i, j));
+    }
 #endif
+
     for (int i = 0; i < gx; i++)
         for (int j = 0; j < gy; j++)
         {
-            dungeon_feature_type feat = unmarshallFeatureType(th);
-            env.grid[i][j] = feat;
-            ASSERT(feat < NUM_FEATURES);
-
-#if TAG_MAJOR_VERSION == 34
-            // Save these for potential destination clean up.
-            if (env.grid[i][j] == DNGN_TRANSPORTER)
-                transporters.push_back(coord_def(i, j));
-#endif
-            unmarshallMapCell(th, env.map_knowledge[i][j]);
             // Fixup positions
-            if (env.map_knowledge[i][j].monsterinfo())
-                env.map_knowledge[i][j].monsterinfo()->pos = coord_def(i, j);
-            if (env.map_knowledge[i][j].cloudinfo())
-                env.map_knowledge[i][j].cloudinfo()->pos = coord_def(i, j);
+            env.map_knowledge[i][j].set_payload_pos(coord_def(i, j));
 
             env.map_knowledge[i][j].flags &= ~MAP_VISIBLE_FLAG;
             if (env.map_knowledge[i][j].seen())
                 env.map_seen.set(i, j);
-            env.pgrid[i][j].flags = unmarshallInt(th);
 
             env.mgrid[i][j] = NON_MONSTER;
         }
@@ -6621,9 +6727,16 @@ static void _tag_read_level(reader &th)
     if (unmarshallBoolean(th))
     {
         MapKnowledge *f = new MapKnowledge();
-        for (int x = 0; x < GXM; x++)
-            for (int y = 0; y < GYM; y++)
-                unmarshallMapCell(th, (*f)[x][y]);
+#if TAG_MAJOR_VERSION == 34
+        if (th.getMinorVersion() < TAG_MINOR_COLUMNAR_LEVEL)
+        {
+            for (int x = 0; x < GXM; x++)
+                for (int y = 0; y < GYM; y++)
+                    unmarshallMapCell(th, (*f)[x][y]);
+        }
+        else
+#endif
+        _unmarshall_map_knowledge(th, *f);
         env.map_forgotten.reset(f);
     }
     else
@@ -6801,8 +6914,15 @@ static void _tag_read_level(reader &th)
     {
         env.heightmap.reset(new grid_heightmap);
         grid_heightmap &heightmap(*env.heightmap);
-        for (rectangle_iterator ri(0); ri; ++ri)
-            heightmap(*ri) = unmarshallShort(th);
+#if TAG_MAJOR_VERSION == 34
+        if (th.getMinorVersion() < TAG_MINOR_COLUMNAR_LEVEL)
+        {
+            for (rectangle_iterator ri(0); ri; ++ri)
+                heightmap(*ri) = unmarshallShort(th);
+        }
+        else
+#endif
+        _run_length_decode(th, unmarshallShort, heightmap, GXM, GYM);
     }
 
     EAT_CANARY;
@@ -7466,6 +7586,8 @@ static void _tag_read_level_monsters(reader &th)
     {
         monster& m = env.mons[i];
         unmarshallMonster(th, m);
+        if (m.type != MONS_NO_MONSTER)
+            env.mons_in_use.add(i);
 
         // place monster
         if (!m.alive())
@@ -8005,3 +8127,102 @@ void tag_write_ghosts(writer &th, const vector<ghost_demon> &ghosts)
     global_ghosts = ghosts;
     tag_write(TAG_GHOST, th);
 }
+
+// The game state outside of level chunks that building levels can change:
+// what the builder has placed so far, portal entrances, stair connectivity,
+// the levelgen rngs and dlua's persistent data. Used by the shared pregen
+// cache, whose entries are only read by the same version that wrote them.
+void tag_write_pregen_state(writer &th)
+{
+    marshallInt(th, you.last_mid);
+
+    marshallShort(th, NUM_MONSTERS);
+    for (int j = 0; j < NUM_MONSTERS; ++j)
+        marshallBoolean(th, you.unique_creatures[j]);
+
+    marshallUByte(th, NUM_UNRANDARTS);
+    for (int j = 0; j < NUM_UNRANDARTS; ++j)
+        marshallByte(th, you.unique_items[j]);
+    marshallUByte(th, you.octopus_king_rings);
+    marshallSet(th, you.generated_misc, _marshall_as_int);
+    marshallInt(th, you.attribute[ATTR_GOLD_GENERATED]);
+
+    marshallByte(th, NUM_BRANCHES);
+    for (int j = 0; j < NUM_BRANCHES; ++j)
+        marshall_level_id(th, brentry[j]);
+
+    _marshall_iterator(th, you.uniq_map_tags.begin(), you.uniq_map_tags.end(),
+                       marshallString);
+    _marshall_iterator(th, you.uniq_map_names.begin(), you.uniq_map_names.end(),
+                       marshallString);
+    marshallMap(th, you.vault_list, marshall_level_id, marshallStringVector);
+    write_level_connectivity(th);
+
+    // Only the levelgen rngs: the others belong to this game alone.
+    const CrawlVector rng_states = rng::generators_to_vector();
+    CrawlVector levelgen_states;
+    for (int i = rng::LEVELGEN; i < rng::NUM_RNGS; ++i)
+        levelgen_states.push_back(rng_states[i]);
+    levelgen_states.write(th);
+
+    if (!dlua.callfn("dgn_save_data", "u", &th))
+        mprf(MSGCH_ERROR, "Failed to save Lua data: %s", dlua.error.c_str());
+}
+
+void tag_read_pregen_state(reader &th)
+{
+    you.last_mid = unmarshallInt(th);
+
+    const int count = unmarshallShort(th);
+    ASSERT(count == NUM_MONSTERS);
+    you.unique_creatures.reset();
+    for (int j = 0; j < count; ++j)
+        you.unique_creatures.set(j, unmarshallBoolean(th));
+
+    const int unrands = unmarshallUByte(th);
+    ASSERT(unrands == NUM_UNRANDARTS);
+    for (int j = 0; j < unrands; ++j)
+    {
+        you.unique_items[j] =
+            static_cast<unique_item_status_type>(unmarshallByte(th));
+    }
+    you.octopus_king_rings = unmarshallUByte(th);
+    you.generated_misc.clear();
+    unmarshallSet(th, you.generated_misc, _unmarshall_misc_item_type);
+    you.attribute[ATTR_GOLD_GENERATED] = unmarshallInt(th);
+
+    const int branch_count = unmarshallByte(th);
+    ASSERT(branch_count == NUM_BRANCHES);
+    for (int j = 0; j < branch_count; ++j)
+        brentry[j] = unmarshall_level_id(th);
+
+    typedef pair<string_set::iterator, bool> ssipair;
+    you.uniq_map_tags.clear();
+    unmarshall_container(th, you.uniq_map_tags,
+                         (ssipair (string_set::*)(const string &))
+                         &string_set::insert,
+                         unmarshallString);
+    you.uniq_map_names.clear();
+    unmarshall_container(th, you.uniq_map_names,
+                         (ssipair (string_set::*)(const string &))
+                         &string_set::insert,
+                         unmarshallString);
+    you.vault_list.clear();
+    unmarshallMap(th, you.vault_list, unmarshall_level_id,
+                  unmarshallStringVector);
+    read_level_connectivity(th);
+
+    CrawlVector levelgen_states;
+    levelgen_states.read(th);
+    ASSERT(levelgen_states.size() == rng::NUM_RNGS - rng::LEVELGEN);
+    CrawlVector rng_states = rng::generators_to_vector();
+    for (int i = rng::LEVELGEN; i < rng::NUM_RNGS; ++i)
+        rng_states[i] = levelgen_states[i - rng::LEVELGEN];
+    rng::load_generators(rng_states);
+
+    if (!dlua.callfn("dgn_load_data", "u", &th))
+    {
+        mprf(MSGCH_ERROR, "Failed to load Lua persist table: %s",
+             dlua.error.c_str());
+    }
+}
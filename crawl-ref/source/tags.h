@@ -183,6 +183,9 @@ static inline void unmarshallSigned(reader& th, T& v)
 void marshallMapCell (writer &, const map_cell &);
 void unmarshallMapCell (reader &, map_cell& cell);
 
+void marshall_level_planes(writer &th);
+void unmarshall_level_planes(reader &th);
+
 FixedVector<spell_type, MAX_KNOWN_SPELLS> unmarshall_player_spells(reader &th);
 
 void unmarshallSpells(reader &, monster_spells &
@@ -210,6 +213,9 @@ player_save_info tag_read_char_info(reader &th, uint8_t format, uint8_t major,
 vector<ghost_demon> tag_read_ghosts(reader &th);
 void tag_write_ghosts(writer &th, const vector<ghost_demon> &ghosts);
 
+void tag_write_pregen_state(writer &th);
+void tag_read_pregen_state(reader &th);
+
 /* ***********************************************************************
  * misc
  * *********************************************************************** */
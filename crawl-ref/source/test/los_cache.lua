@@ -0,0 +1,62 @@
+-- Check that terrain changes forget exactly enough of the cell_see_cell
+-- cache: after each change, cached answers must match a fresh
+-- computation.
+
+local FAILMAP = 'loscache.map'
+local checks = 0
+
+local function cached_view(cx, cy)
+  local seen = { }
+  for y = -8, 8 do
+    for x = -8, 8 do
+      local px, py = cx + x, cy + y
+      if dgn.in_bounds(px, py) then
+        seen[x .. "," .. y] = los.cell_see_cell(cx, cy, px, py)
+      end
+    end
+  end
+  return seen
+end
+
+local function test_los_cache()
+  you.random_teleport()
+  local you_x, you_y = you.pos()
+
+  -- Warm the cache.
+  cached_view(you_x, you_y)
+
+  for i = 1, 10 do
+    local x = you_x + crawl.random_range(-6, 6)
+    local y = you_y + crawl.random_range(-6, 6)
+    if (x ~= you_x or y ~= you_y) and dgn.in_bounds(x, y) then
+      checks = checks + 1
+      local feat = dgn.feature_name(dgn.grid(x, y))
+      local new_feat = feat == "floor" and "rock_wall" or "floor"
+      dgn.terrain_changed(x, y, new_feat, false, false)
+
+      local cached = cached_view(you_x, you_y)
+      debug.los_changed()
+      local fresh = cached_view(you_x, you_y)
+      for k, v in pairs(fresh) do
+        if cached[k] ~= v then
+          dgn.fprop_changed(x, y, "highlight")
+          debug.dump_map(FAILMAP)
+          assert(false,
+                 "stale cell_see_cell (check #" .. checks .. ") at offset "
+                   .. k .. " from " .. dgn.point(you_x, you_y)
+                   .. " after changing " .. dgn.point(x, y)
+                   .. ". Map saved to " .. FAILMAP)
+        end
+      end
+    end
+  end
+end
+
+for depth = 1, 10 do
+  debug.goto_place("D:" .. depth)
+  debug.flush_map_memory()
+  debug.generate_level()
+  for i = 1, 3 do
+    test_los_cache()
+  end
+end
@@ -0,0 +1,55 @@
+-- Time world_reacts() on a sparse and a crowded level, and check that
+-- monster_iterator sees every monster on the map. Run before and after
+-- changes to monster bookkeeping to compare the timings.
+
+local TURNS = 100
+
+local function count_monsters()
+  local count = 0
+  local gxm, gym = dgn.max_bounds()
+  for y = 0, gym - 1 do
+    for x = 0, gxm - 1 do
+      if dgn.mons_at(x, y) then
+        count = count + 1
+      end
+    end
+  end
+  return count
+end
+
+-- Fill the level with up to want good neutral monsters, which won't bother
+-- the player.
+local function populate(want)
+  dgn.dismiss_monsters()
+  local placed = 0
+  local gxm, gym = dgn.max_bounds()
+  for y = 1, gym - 2 do
+    for x = 1, gxm - 2 do
+      if placed < want and dgn.is_passable(x, y) and not dgn.mons_at(x, y)
+         and dgn.create_monster(x, y, "rat att:good_neutral") then
+        placed = placed + 1
+      end
+    end
+  end
+  return placed
+end
+
+local function time_level(name, want)
+  debug.goto_place("D:3")
+  debug.flush_map_memory()
+  debug.generate_level()
+  local placed = populate(want)
+
+  local ms, seen = debug.world_reacts(TURNS)
+  local expected = count_monsters()
+  assert(seen == expected,
+         name .. " level: monster_iterator saw " .. seen .. " monsters, but "
+           .. expected .. " are on the map")
+  crawl.stderr(string.format("world_reacts, %s level (%d monsters): "
+                             .. "%.3f ms/turn",
+                             name, placed, ms / TURNS))
+end
+
+time_level("sparse", 15)
+time_level("dense", 600)
+dgn.dismiss_monsters()
@@ -3,6 +3,7 @@
 #ifndef TARGET_OS_WINDOWS
 
 #include <pthread.h>
+#include <time.h>
 
 #ifndef PTHREAD_CREATE_JOINABLE
 // AIX
@@ -15,6 +16,7 @@
 
 #define mutex_t pthread_mutex_t
 #define mutex_lock(x) pthread_mutex_lock(&x)
+#define mutex_trylock(x) (!pthread_mutex_trylock(&x))
 #define mutex_unlock(x) pthread_mutex_unlock(&x)
 static inline void mutex_init(pthread_mutex_t &x)
 {
@@ -53,6 +55,19 @@ static inline int unix_pthread_create(pthread_t *th, int det,
 #define cond_destroy(x) pthread_cond_destroy(&x)
 #define cond_wait(x,m) pthread_cond_wait(&x, &m)
 #define cond_wake(x) pthread_cond_signal(&x)
+static inline void cond_wait_ms(pthread_cond_t &x, pthread_mutex_t &m, int ms)
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&x, &m, &ts);
+}
 
 
 #else
@@ -63,6 +78,7 @@ static inline int unix_pthread_create(pthread_t *th, int det,
 
 #define mutex_t CRITICAL_SECTION
 #define mutex_lock(x) EnterCriticalSection(&x)
+#define mutex_trylock(x) TryEnterCriticalSection(&x)
 #define mutex_unlock(x) LeaveCriticalSection(&x)
 #define mutex_init(x) InitializeCriticalSection(&x);
 #define mutex_destroy(x) DeleteCriticalSection(&x);
@@ -96,5 +112,6 @@ static inline int win32_thread_create_detached(thread_t *th,
 #define cond_destroy(x) CloseHandle(x);
 #define cond_wait(x,m) {mutex_unlock(m);WaitForSingleObject(x, INFINITE);mutex_lock(m);}
 #define cond_wake(x) PulseEvent(x)
+#define cond_wait_ms(x,m,ms) {mutex_unlock(m);WaitForSingleObject(x, ms);mutex_lock(m);}
 
 #endif
@@ -0,0 +1,455 @@
+#include "AppHdr.h"
+
+#ifdef USE_TILE_WEB
+
+#include "tileweb-queue.h"
+
+#include <cerrno>
+#include <chrono>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#if defined(UNIX) || defined(TARGET_COMPILER_MINGW)
+#include <unistd.h>
+#endif
+
+#include "stringutil.h"
+
+//#define DEBUG_WEBSOCKETS
+
+// The most fragments handed to the kernel in one go.
+static const int MAX_BATCH = 32;
+
+// How long a destination may refuse all data before we give up on it.
+// This roughly matches the retries of the old synchronous sender.
+static const uint64_t STALL_LIMIT_MS = 60 * 1000;
+
+static uint64_t _now_ms()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(
+        steady_clock::now().time_since_epoch()).count();
+}
+
+WebOutputQueue::WebOutputQueue() :
+    policy(web_backpressure::block),
+    capacity(1024 * 1024),
+    m_sock(-1),
+    m_max_fragment(0),
+    m_running(false),
+    m_stopping(false),
+    m_resync(false),
+    m_stats()
+{
+    mutex_init(m_mutex);
+    cond_init(m_work);
+    cond_init(m_space);
+}
+
+WebOutputQueue::~WebOutputQueue()
+{
+    stop(0);
+    cond_destroy(m_space);
+    cond_destroy(m_work);
+    mutex_destroy(m_mutex);
+}
+
+void WebOutputQueue::start(int sock, int max_fragment)
+{
+    ASSERT(!m_running);
+    m_sock = sock;
+    m_max_fragment = max_fragment;
+    m_stopping = false;
+    if (thread_create_joinable(&m_thread, _writer_main, this))
+        die("Can't start the webtiles writer thread!");
+    m_running = true;
+}
+
+void WebOutputQueue::stop(int drain_ms)
+{
+    if (!m_running)
+        return;
+
+    const uint64_t deadline = _now_ms() + drain_ms;
+    mutex_lock(m_mutex);
+    while (_now_ms() < deadline && m_error.empty())
+    {
+        bool pending = false;
+        for (const auto &dest : m_dests)
+            pending = pending || (!dest->dead && !dest->queue.empty());
+        if (!pending)
+            break;
+        mutex_unlock(m_mutex);
+        usleep(10 * 1000);
+        mutex_lock(m_mutex);
+    }
+    m_stopping = true;
+    cond_wake(m_work);
+    mutex_unlock(m_mutex);
+
+    thread_join(m_thread);
+    m_running = false;
+}
+
+void WebOutputQueue::add_destination(const sockaddr_un &addr, bool primary)
+{
+    auto dest = make_shared<destination>();
+    dest->addr = addr;
+    dest->primary = primary;
+    dest->dead = false;
+    dest->sync = sync_state::normal;
+    dest->offset = 0;
+    dest->in_flight = 0;
+    dest->queued_bytes = 0;
+    dest->stalled_since = 0;
+
+    mutex_lock(m_mutex);
+    m_dests.push_back(move(dest));
+    mutex_unlock(m_mutex);
+}
+
+bool WebOutputQueue::has_destinations()
+{
+    bool any = false;
+    mutex_lock(m_mutex);
+    for (const auto &dest : m_dests)
+        any = any || !dest->dead;
+    mutex_unlock(m_mutex);
+    return any;
+}
+
+void WebOutputQueue::push(const string &msg)
+{
+    const frame shared = make_shared<const string>(msg);
+
+    mutex_lock(m_mutex);
+    // _wait_for_space() may let the writer drop destinations meanwhile.
+    const auto dests = m_dests;
+    for (unsigned i = 0; i < dests.size() && m_error.empty(); ++i)
+    {
+        destination &dest = *dests[i];
+        if (dest.dead)
+            continue;
+        // It will get this as part of the resend.
+        if (dest.sync == sync_state::stale)
+        {
+            m_stats.coalesced++;
+            continue;
+        }
+
+        // A message bigger than the whole queue is let through alone.
+        if (dest.sync == sync_state::normal && !dest.queue.empty()
+            && dest.queued_bytes + msg.size() > capacity)
+        {
+            if (dest.primary || policy == web_backpressure::block)
+                _wait_for_space(dest, msg.size());
+            else if (policy == web_backpressure::drop)
+            {
+#ifdef DEBUG_WEBSOCKETS
+                fprintf(stderr, "websocket: dropping slow client %d.\n", i);
+#endif
+                dest.dead = true;
+                m_stats.dropped++;
+                continue;
+            }
+            else
+            {
+                _coalesce(dest);
+                continue;
+            }
+        }
+
+        if (dest.dead)
+            continue;
+        dest.queue.push_back(shared);
+        dest.queued_bytes += msg.size();
+        m_stats.bytes += msg.size();
+        m_stats.max_queue_bytes = max(m_stats.max_queue_bytes,
+                                      dest.queued_bytes);
+    }
+    m_stats.messages++;
+
+    const string error = m_error;
+    cond_wake(m_work);
+    mutex_unlock(m_mutex);
+
+    if (!error.empty())
+        die("%s", error.c_str());
+}
+
+void WebOutputQueue::_wait_for_space(destination &dest, size_t size)
+{
+    const uint64_t start = _now_ms();
+    while (!dest.dead && m_error.empty() && !dest.queue.empty()
+           && dest.queued_bytes + size > capacity)
+    {
+        cond_wait(m_space, m_mutex);
+    }
+    m_stats.game_stall_ms += _now_ms() - start;
+}
+
+// Throw away everything the writer hasn't started on, and have the game
+// send everything again once it is ready to.
+void WebOutputQueue::_coalesce(destination &dest)
+{
+    while (dest.queue.size() > max<size_t>(dest.in_flight, 1))
+    {
+        dest.queued_bytes -= dest.queue.back()->size();
+        dest.queue.pop_back();
+        m_stats.coalesced++;
+    }
+    m_stats.coalesced++; // the message that didn't fit
+    dest.sync = sync_state::stale;
+    m_resync = true;
+}
+
+bool WebOutputQueue::take_resync()
+{
+    mutex_lock(m_mutex);
+    const bool resync = m_resync;
+    if (resync)
+    {
+        for (auto &dest : m_dests)
+            if (dest->sync == sync_state::stale)
+                dest->sync = sync_state::resyncing;
+        m_resync = false;
+    }
+    mutex_unlock(m_mutex);
+    return resync;
+}
+
+void WebOutputQueue::resync_done()
+{
+    mutex_lock(m_mutex);
+    for (auto &dest : m_dests)
+        if (dest->sync == sync_state::resyncing)
+            dest->sync = sync_state::normal;
+    mutex_unlock(m_mutex);
+}
+
+web_output_stats WebOutputQueue::_locked_stats()
+{
+    web_output_stats stats = m_stats;
+    stats.queue_bytes = 0;
+    for (const auto &dest : m_dests)
+        if (!dest->dead)
+            stats.queue_bytes = max(stats.queue_bytes, dest->queued_bytes);
+    return stats;
+}
+
+web_output_stats WebOutputQueue::stats()
+{
+    mutex_lock(m_mutex);
+    const web_output_stats stats = _locked_stats();
+    mutex_unlock(m_mutex);
+    return stats;
+}
+
+string WebOutputQueue::describe_stats(bool crashing)
+{
+    web_output_stats s;
+    if (!crashing)
+        s = stats();
+    else if (mutex_trylock(m_mutex))
+    {
+        s = _locked_stats();
+        mutex_unlock(m_mutex);
+    }
+    else
+        return "unavailable, the queue is locked";
+
+    return make_stringf("%" PRIu64 " messages, %" PRIu64 " bytes queued; "
+                        "%" PRIu64 " fragments in %" PRIu64 " sends; "
+                        "queue depth %u (max %u) bytes; "
+                        "writer stalled %" PRIu64 "ms, "
+                        "game stalled %" PRIu64 "ms; "
+                        "%u clients dropped, %u messages coalesced",
+                        s.messages, s.bytes, s.fragments, s.sends,
+                        (unsigned) s.queue_bytes, (unsigned) s.max_queue_bytes,
+                        s.writer_stall_ms, s.game_stall_ms,
+                        s.dropped, s.coalesced);
+}
+
+void *WebOutputQueue::_writer_main(void *queue)
+{
+    static_cast<WebOutputQueue *>(queue)->_run_writer();
+    return nullptr;
+}
+
+// Send as many fragments as the kernel will take in one syscall. Returns
+// the number sent, or -1 and sets errno if none were.
+int WebOutputQueue::_send_batch(
+    const destination &dest,
+    const vector<pair<const char *, size_t>> &fragments)
+{
+#ifdef __linux__
+    mmsghdr msgs[MAX_BATCH];
+    iovec iov[MAX_BATCH];
+    const int count = min<int>(fragments.size(), MAX_BATCH);
+    for (int i = 0; i < count; ++i)
+    {
+        iov[i].iov_base = const_cast<char *>(fragments[i].first);
+        iov[i].iov_len = fragments[i].second;
+        msgs[i].msg_hdr = msghdr();
+        msgs[i].msg_hdr.msg_name = (void *) &dest.addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_un);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_len = 0;
+    }
+    return sendmmsg(m_sock, msgs, count, MSG_DONTWAIT);
+#else
+    int sent = 0;
+    for (const auto &fragment : fragments)
+    {
+        const ssize_t retval = sendto(m_sock, fragment.first, fragment.second,
+                                      MSG_DONTWAIT, (sockaddr*) &dest.addr,
+                                      sizeof(sockaddr_un));
+        if (retval < (ssize_t) fragment.second)
+            return sent ? sent : retval;
+        sent++;
+    }
+    return sent;
+#endif
+}
+
+// Try to send some fragments to dest. Called and returns with the lock held,
+// but does not hold it while sending.
+bool WebOutputQueue::_send_some(destination &dest, string &errmsg)
+{
+    // The game thread only appends to the queue, or trims it behind the
+    // frames in flight, so those stay put while we're unlocked.
+    vector<pair<const char *, size_t>> fragments;
+    size_t offset = dest.offset;
+    for (const frame &msg : dest.queue)
+    {
+        while (offset < msg->size() && fragments.size() < MAX_BATCH)
+        {
+            const size_t size = min(msg->size() - offset, m_max_fragment);
+            fragments.emplace_back(msg->data() + offset, size);
+            offset += size;
+        }
+        dest.in_flight++;
+        if (fragments.size() == MAX_BATCH)
+            break;
+        offset = 0;
+    }
+
+    mutex_unlock(m_mutex);
+    const int retval = _send_batch(dest, fragments);
+    const int err = errno;
+    mutex_lock(m_mutex);
+
+    dest.in_flight = 0;
+    m_stats.sends++;
+    if (retval > 0)
+    {
+        for (int i = 0; i < retval; ++i)
+        {
+            dest.offset += fragments[i].second;
+            dest.queued_bytes -= fragments[i].second;
+            if (dest.offset == dest.queue.front()->size())
+            {
+                dest.queue.pop_front();
+                dest.offset = 0;
+            }
+        }
+        m_stats.fragments += retval;
+        dest.stalled_since = 0;
+        return true;
+    }
+
+    if (retval == 0 || err == ENOBUFS || err == EWOULDBLOCK
+        || err == EINTR || err == EAGAIN)
+    {
+        const uint64_t now = _now_ms();
+        if (!dest.stalled_since)
+            dest.stalled_since = now;
+        else if (now - dest.stalled_since > STALL_LIMIT_MS)
+        {
+            const char *reason = retval == 0 ? "No bytes sent"
+                                             : strerror(err);
+            if (dest.primary)
+                errmsg = make_stringf("Socket write error: %s", reason);
+            else
+            {
+                dest.dead = true;
+                m_stats.dropped++;
+            }
+        }
+    }
+    else if (err == ECONNREFUSED || err == ENOENT)
+    {
+        // the other side is dead
+#ifdef DEBUG_WEBSOCKETS
+        fprintf(stderr, "websocket: send failed (%s), dropping client.\n",
+                strerror(err));
+#endif
+        dest.dead = true;
+    }
+    else
+        errmsg = make_stringf("Socket write error: %s", strerror(err));
+
+    return false;
+}
+
+void WebOutputQueue::_run_writer()
+{
+    int backoff_ms = 0;
+
+    mutex_lock(m_mutex);
+    while (m_error.empty() && !m_stopping)
+    {
+        bool dropped = false;
+        for (unsigned i = 0; i < m_dests.size(); ++i)
+            if (m_dests[i]->dead)
+            {
+                m_dests.erase(m_dests.begin() + i--);
+                dropped = true;
+            }
+        // A dead destination may be what the game is waiting for.
+        if (dropped)
+            cond_wake(m_space);
+
+        bool pending = false;
+        bool progress = false;
+        string errmsg;
+        const auto dests = m_dests;
+        for (unsigned i = 0; i < dests.size() && errmsg.empty(); ++i)
+        {
+            destination &dest = *dests[i];
+            if (dest.dead || dest.queue.empty())
+                continue;
+            pending = true;
+            progress = _send_some(dest, errmsg) || progress;
+        }
+
+        if (!errmsg.empty())
+        {
+            m_error = errmsg;
+            cond_wake(m_space);
+            break;
+        }
+
+        if (progress)
+        {
+            backoff_ms = 0;
+            cond_wake(m_space);
+        }
+        else if (pending)
+        {
+            // Every destination with something to send is full. Wait a
+            // little, backing off up to a tenth of a second, unless more
+            // messages come in for a destination that may be ready.
+            backoff_ms = min(max(backoff_ms * 2, 2), 100);
+            const uint64_t start = _now_ms();
+            cond_wait_ms(m_work, m_mutex, backoff_ms);
+            m_stats.writer_stall_ms += _now_ms() - start;
+        }
+        else
+            cond_wait(m_work, m_mutex);
+    }
+    mutex_unlock(m_mutex);
+}
+
+#endif
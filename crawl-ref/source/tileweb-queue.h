@@ -0,0 +1,126 @@
+#ifdef USE_TILE_WEB
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/un.h>
+
+#include "threads.h"
+
+// What to do when a destination's queue is full.
+enum class web_backpressure
+{
+    block,    // wait for the writer to catch up
+    drop,     // stop sending to the slow destination
+    coalesce, // throw away its backlog and send it everything afresh
+};
+
+struct web_output_stats
+{
+    uint64_t messages;       // messages queued
+    uint64_t bytes;          // bytes queued, over all destinations
+    uint64_t sends;          // send syscalls made by the writer
+    uint64_t fragments;      // fragments sent, over all destinations
+    size_t queue_bytes;      // current depth of the deepest queue
+    size_t max_queue_bytes;  // deepest any queue has been
+    uint64_t writer_stall_ms; // writer time spent waiting on full sockets
+    uint64_t game_stall_ms;  // game time spent waiting on full queues
+    unsigned dropped;        // destinations dropped for being too slow
+    unsigned coalesced;      // messages discarded by coalescing
+};
+
+/* Outbound webtiles messages. Each destination has its own bounded queue,
+   which a writer thread drains, so that a slow reader no longer stalls the
+   game in sendto().
+
+   A message is stored once and shared by the queues of all destinations,
+   and the writer hands the kernel a batch of fragments per syscall where
+   it can (sendmmsg on Linux).
+
+   The destination that controls the game is always subject to the block
+   policy: its client can't recover from lost messages.
+ */
+class WebOutputQueue
+{
+public:
+    WebOutputQueue();
+    ~WebOutputQueue();
+
+    void start(int sock, int max_fragment);
+    // Give the writer up to drain_ms to empty the queues, then stop it.
+    void stop(int drain_ms);
+
+    void add_destination(const sockaddr_un &addr, bool primary);
+    bool has_destinations();
+
+    // Queue a complete message for every destination. Dies if the writer
+    // has hit a fatal socket error.
+    void push(const string &msg);
+
+    // Whether a destination has lost messages to coalescing, and needs
+    // everything to be sent again. If so, call resync_done() after
+    // resending.
+    bool take_resync();
+    void resync_done();
+
+    web_output_stats stats();
+    // When crashing, the lock may be held by a thread that will never let
+    // go of it, so describe nothing rather than wait for it.
+    string describe_stats(bool crashing = false);
+
+    web_backpressure policy;
+    size_t capacity; // per destination, in bytes
+
+private:
+    enum class sync_state
+    {
+        normal,
+        stale,     // discarding messages until everything is resent
+        resyncing, // accepting everything until the resend is done
+    };
+
+    typedef shared_ptr<const string> frame;
+
+    struct destination
+    {
+        sockaddr_un addr;
+        bool primary;
+        bool dead;
+        sync_state sync;
+        deque<frame> queue;
+        size_t offset;       // already sent from queue.front()
+        size_t in_flight;    // queued frames the writer is sending from
+        size_t queued_bytes;
+        uint64_t stalled_since;
+    };
+
+    static void *_writer_main(void *queue);
+    void _run_writer();
+    bool _send_some(destination &dest, string &errmsg);
+    int _send_batch(const destination &dest,
+                    const vector<pair<const char *, size_t>> &fragments);
+    void _wait_for_space(destination &dest, size_t size);
+    void _coalesce(destination &dest);
+    web_output_stats _locked_stats();
+
+    int m_sock;
+    size_t m_max_fragment;
+    bool m_running;
+    bool m_stopping;
+    string m_error;
+    bool m_resync;
+
+    // Shared, so that either thread can keep using a destination while the
+    // lock is released, even if the other one drops it.
+    vector<shared_ptr<destination>> m_dests;
+    web_output_stats m_stats;
+
+    mutex_t m_mutex;
+    cond_t m_work;  // signalled when messages are queued
+    cond_t m_space; // signalled when the writer makes progress
+    thread_t m_thread;
+};
+#endif
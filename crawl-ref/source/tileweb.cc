@@ -83,6 +83,8 @@ static unsigned int get_milliseconds()
 
 TilesFramework tiles;
 
+static const size_t INITIAL_MSG_BUF_SIZE = 64 * 1024;
+
 TilesFramework::TilesFramework() :
       m_controlled_from_web(false),
       _send_lock(false),
@@ -102,6 +104,10 @@ TilesFramework::TilesFramework() :
     default_cell.tile.bg = TILE_FLAG_UNSEEN;
     m_current_view.fill(default_cell);
     m_next_view.fill(default_cell);
+
+    // The message buffer is reused for every message and only ever grows,
+    // so after the first full map it is large enough for anything.
+    m_msg_buf.reserve(INITIAL_MSG_BUF_SIZE);
 }
 
 TilesFramework::~TilesFramework()
@@ -113,8 +119,19 @@ void TilesFramework::shutdown()
     if (m_sock_name.empty())
         return;
 
+    // Give the writer a few seconds to deliver the last messages, such as
+    // the exit reason.
+    m_output.stop(5000);
+    const web_output_stats stats = m_output.stats();
+    if (stats.game_stall_ms || stats.dropped || stats.coalesced)
+    {
+        fprintf(stderr, "Webtiles output: %s\n",
+                m_output.describe_stats().c_str());
+    }
+
     close(m_sock);
     remove(m_sock_name.c_str());
+    m_sock_name.clear();
 }
 
 void TilesFramework::draw_doll_edit()
@@ -155,6 +172,8 @@ bool TilesFramework::initialise()
     if (setsockopt(m_sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0)
         die("Can't set send timeout!");
 
+    m_output.start(m_sock, m_max_msg_size);
+
     if (m_await_connection)
         _await_connection();
 
@@ -171,20 +190,34 @@ string TilesFramework::get_message()
     return m_msg_buf;
 }
 
-void TilesFramework::write_message(const char *format, ...)
+void TilesFramework::_vwrite_message(const char *format, va_list argp)
 {
+    va_list again;
+    va_copy(again, argp);
+
     char buf[2048];
-    int len;
+    const int len = vsnprintf(buf, sizeof(buf), format, argp);
+    if (len < 0)
+        die("Webtiles message format error! (%s)", format);
+    else if (len < (int)sizeof(buf))
+        m_msg_buf.append(buf, len);
+    else
+    {
+        // Too long for the stack buffer: format straight into the message.
+        const size_t start = m_msg_buf.size();
+        m_msg_buf.resize(start + len + 1);
+        vsnprintf(&m_msg_buf[start], len + 1, format, again);
+        m_msg_buf.resize(start + len);
+    }
+    va_end(again);
+}
 
+void TilesFramework::write_message(const char *format, ...)
+{
     va_list argp;
     va_start(argp, format);
-    if ((len = vsnprintf(buf, sizeof(buf), format, argp)) < 0)
-        die("Webtiles message format error! (%s)", format);
-    else if (len >= (int)sizeof(buf))
-        die("Webtiles message too long! (%d)", len);
+    _vwrite_message(format, argp);
     va_end(argp);
-
-    m_msg_buf.append(buf);
 }
 
 void TilesFramework::finish_message()
@@ -193,7 +226,7 @@ void TilesFramework::finish_message()
         return;
 #ifdef DEBUG_WEBSOCKETS
     const int initial_buf_size = m_msg_buf.size();
-    fprintf(stderr, "websocket: About to send %d bytes.\n", initial_buf_size);
+    fprintf(stderr, "websocket: About to queue %d bytes.\n", initial_buf_size);
 #endif
 
     if (m_sock_name.empty())
@@ -203,107 +236,25 @@ void TilesFramework::finish_message()
     }
 
     m_msg_buf.append("\n");
-    const char* fragment_start = m_msg_buf.data();
-    const char* data_end = m_msg_buf.data() + m_msg_buf.size();
-    int fragments = 0;
-    while (fragment_start < data_end)
-    {
-        int fragment_size = data_end - fragment_start;
-        if (fragment_size > m_max_msg_size)
-            fragment_size = m_max_msg_size;
-        fragments++;
-
-        for (unsigned int i = 0; i < m_dest_addrs.size(); ++i)
-        {
-            int retries = 30;
-            ssize_t sent = 0;
-            while (sent < fragment_size)
-            {
-                ssize_t retval = sendto(m_sock, fragment_start + sent,
-                    fragment_size - sent, 0, (sockaddr*) &m_dest_addrs[i],
-                    sizeof(sockaddr_un));
-#ifdef DEBUG_WEBSOCKETS
-                fprintf(stderr,
-                            "    trying to send fragment to client %d...", i);
-#endif
-                if (retval <= 0)
-                {
-                    const char *errmsg = retval == 0 ? "No bytes sent"
-                                                     : strerror(errno);
-                    if (--retries <= 0)
-                        die("Socket write error: %s", errmsg);
-
-                    if (retval == 0 || errno == ENOBUFS || errno == EWOULDBLOCK
-                        || errno == EINTR || errno == EAGAIN)
-                    {
-                        // Wait for half a second at first (up to five), then
-                        // try again.
-                        const int sleep_time = retries > 25 ? 2 * 1000
-                                             : retries > 10 ? 500 * 1000
-                                             : 5000 * 1000;
-#ifdef DEBUG_WEBSOCKETS
-                        fprintf(stderr, "failed (%s), sleeping for %dms.\n",
-                                                    errmsg, sleep_time / 1000);
-#endif
-                        usleep(sleep_time);
-                    }
-                    else if (errno == ECONNREFUSED || errno == ENOENT)
-                    {
-                        // the other side is dead
-#ifdef DEBUG_WEBSOCKETS
-                        fprintf(stderr,
-                            "failed (%s), breaking.\n", errmsg);
-#endif
-                        m_dest_addrs.erase(m_dest_addrs.begin() + i);
-                        i--;
-                        break;
-                    }
-                    else
-                        die("Socket write error: %s", errmsg);
-                }
-                else
-                {
-#ifdef DEBUG_WEBSOCKETS
-                    fprintf(stderr, "fragment size %d sent.\n", fragment_size);
-#endif
-                    sent += retval;
-                }
-            }
-        }
-
-        fragment_start += fragment_size;
-    }
+    m_output.push(m_msg_buf);
     m_msg_buf.clear();
     m_need_flush = true;
 #ifdef DEBUG_WEBSOCKETS
     // should the game actually crash in this case?
-    if (m_controlled_from_web && m_dest_addrs.size() == 0)
+    if (m_controlled_from_web && !has_receivers())
         fprintf(stderr, "No open websockets after finish_message!!\n");
 
-    fprintf(stderr, "websocket: Sent %d bytes in %d fragments.\n",
-                                                initial_buf_size, fragments);
+    fprintf(stderr, "websocket: Queued %d bytes.\n", initial_buf_size);
 #endif
 }
 
 void TilesFramework::send_message(const char *format, ...)
 {
-    char buf[2048];
-    int len;
-
     va_list argp;
     va_start(argp, format);
-    if ((len = vsnprintf(buf, sizeof(buf), format, argp)) >= (int)sizeof(buf)
-        || len == -1)
-    {
-        if (len == -1)
-            die("Webtiles message format error! (%s)", format);
-        else
-            die("Webtiles message too long! (%d)", len);
-    }
+    _vwrite_message(format, argp);
     va_end(argp);
 
-    m_msg_buf.append(buf);
-
     finish_message();
 }
 
@@ -313,6 +264,14 @@ void TilesFramework::flush_messages()
         return;
     unwind_bool no_rentry(_send_lock, true);
 
+    // A slow client lost messages to coalescing; catch it up the same way
+    // as a new spectator.
+    if (m_output.take_resync())
+    {
+        _send_everything();
+        m_output.resync_done();
+    }
+
     if (m_need_flush)
     {
         send_message("*{\"msg\":\"flush_messages\"}");
@@ -325,7 +284,7 @@ void TilesFramework::_await_connection()
     if (m_sock_name.empty())
         return;
 
-    while (m_dest_addrs.size() == 0)
+    while (!has_receivers())
         _receive_control_message();
 }
 
@@ -436,7 +395,7 @@ wint_t TilesFramework::_handle_control_message(sockaddr_un addr, string data)
         JsonWrapper primary = json_find_member(obj.node, "primary");
         primary.check(JSON_BOOL);
 
-        m_dest_addrs.push_back(addr);
+        m_output.add_destination(addr, primary->bool_);
         m_controlled_from_web = primary->bool_;
     }
     else if (msgtype == "key")
@@ -671,6 +630,11 @@ bool TilesFramework::await_input(wint_t& c, bool block)
 void TilesFramework::dump()
 {
     fprintf(stderr, "Webtiles message buffer: %s\n", m_msg_buf.c_str());
+    if (!m_sock_name.empty())
+    {
+        fprintf(stderr, "Webtiles output: %s\n",
+                m_output.describe_stats(true).c_str());
+    }
     fprintf(stderr, "Webtiles JSON stack:\n");
     for (const JsonFrame &frame : m_json_stack)
     {
@@ -953,7 +917,7 @@ void TilesFramework::update_input_mode(mouse_mode mode, bool force)
 
 static bool _update_string(bool force, string& current,
                            const string& next,
-                           const string& name,
+                           const char *name,
                            bool update = true)
 {
     if (force || current != next)
@@ -968,7 +932,7 @@ static bool _update_string(bool force, string& current,
 }
 
 template<class T> static bool _update_int(bool force, T& current, T next,
-                                          const string& name,
+                                          const char *name,
                                           bool update = true)
 {
     if (force || current != next)
@@ -1246,7 +1210,7 @@ void TilesFramework::_send_player(bool force_full)
     for (unsigned int i = EQ_FIRST_EQUIP; i < NUM_EQUIP; ++i)
     {
         const int8_t equip = !you.melded[i] ? you.equip[i] : -1;
-        _update_int(force_full, c.equip[i], equip, to_string(i));
+        _update_int(force_full, c.equip[i], equip, to_string(i).c_str());
     }
     json_close_object(true);
 
@@ -1442,8 +1406,10 @@ void TilesFramework::send_doll(const dolls_data &doll, bool submerged, bool ghos
             continue;
 
         const int ymax = flags[p] == TILEP_FLAG_CUT_BOTTOM ? 18 : TILE_Y;
-        tiles.json_write_comma();
-        tiles.write_message("[%u,%d]", (unsigned int) doll.parts[p], ymax);
+        tiles.json_open_array();
+        tiles.json_write_int(doll.parts[p]);
+        tiles.json_write_int(ymax);
+        tiles.json_close_array();
     }
     tiles.json_close_array();
 }
@@ -1461,8 +1427,8 @@ void TilesFramework::send_mcache(mcache_entry *entry, bool submerged, bool send)
             send_doll(*doll, submerged, trans);
         else
         {
-            tiles.json_write_comma();
-            tiles.write_message("\"doll\":[]");
+            tiles.json_open_array("doll");
+            tiles.json_close_array();
         }
     }
 
@@ -1472,9 +1438,11 @@ void TilesFramework::send_mcache(mcache_entry *entry, bool submerged, bool send)
     int draw_info_count = entry->info(&dinfo[0]);
     for (int i = 0; i < draw_info_count; i++)
     {
-        tiles.json_write_comma();
-        tiles.write_message("[%u,%d,%d]", (unsigned int) dinfo[i].idx,
-                            dinfo[i].ofs_x, dinfo[i].ofs_y);
+        tiles.json_open_array();
+        tiles.json_write_int(dinfo[i].idx);
+        tiles.json_write_int(dinfo[i].ofs_x);
+        tiles.json_write_int(dinfo[i].ofs_y);
+        tiles.json_close_array();
     }
 
     tiles.json_close_array();
@@ -1518,9 +1486,15 @@ void TilesFramework::write_tileidx(tileidx_t t)
     const int lo = t & 0xFFFFFFFF;
     const int hi = t >> 32;
     if (hi == 0)
-        tiles.write_message("%d", lo);
+        _write_int(lo);
     else
-        tiles.write_message("[%d,%d]", lo, hi);
+    {
+        m_msg_buf.push_back('[');
+        _write_int(lo);
+        m_msg_buf.push_back(',');
+        _write_int(hi);
+        m_msg_buf.push_back(']');
+    }
 }
 
 void TilesFramework::_send_cell(const coord_def &gc,
@@ -1668,8 +1642,12 @@ void TilesFramework::_send_cell(const coord_def &gc,
                     send_mcache(entry, in_water);
                 else
                 {
-                    json_write_comma();
-                    write_message("\"doll\":[[%d,%d]]", TILEP_MONS_UNKNOWN, TILE_Y);
+                    json_open_array("doll");
+                    json_open_array();
+                    json_write_int(TILEP_MONS_UNKNOWN);
+                    json_write_int(TILE_Y);
+                    json_close_array();
+                    json_close_array();
                     json_write_null("mcache");
                 }
             }
@@ -1720,8 +1698,12 @@ void TilesFramework::_send_cell(const coord_def &gc,
         {
             if (fg_changed)
             {
-                json_write_comma();
-                write_message("\"doll\":[[%u,%d]]", (unsigned int) fg_idx, TILE_Y);
+                json_open_array("doll");
+                json_open_array();
+                json_write_int(fg_idx);
+                json_write_int(TILE_Y);
+                json_close_array();
+                json_close_array();
                 json_write_null("mcache");
             }
         }
@@ -1729,7 +1711,6 @@ void TilesFramework::_send_cell(const coord_def &gc,
         {
             if (fg_changed)
             {
-                json_write_comma();
                 json_write_null("doll");
                 json_write_null("mcache");
             }
@@ -1764,16 +1745,20 @@ void TilesFramework::_send_cell(const coord_def &gc,
 
 void TilesFramework::_send_cursor(cursor_type type)
 {
-    if (m_cursor[type] == NO_CURSOR)
-        send_message("{\"msg\":\"cursor\",\"id\":%d}", type);
-    else
+    json_open_object();
+    json_write_string("msg", "cursor");
+    json_write_int("id", type);
+    if (m_cursor[type] != NO_CURSOR)
     {
         if (m_origin.equals(-1, -1))
             m_origin = m_cursor[type];
-        send_message("{\"msg\":\"cursor\",\"id\":%d,\"loc\":{\"x\":%d,\"y\":%d}}",
-                     type, m_cursor[type].x - m_origin.x,
-                     m_cursor[type].y - m_origin.y);
+        json_open_object("loc");
+        json_write_int("x", m_cursor[type].x - m_origin.x);
+        json_write_int("y", m_cursor[type].y - m_origin.y);
+        json_close_object();
     }
+    json_close_object();
+    finish_message();
 }
 
 void TilesFramework::_mcache_ref(bool inc)
@@ -2401,34 +2386,68 @@ bool TilesFramework::cell_needs_redraw(const coord_def& gc)
 
 void TilesFramework::write_message_escaped(const string& s)
 {
-    for (unsigned char c : s)
+    write_message_escaped(s.data(), s.size());
+}
+
+void TilesFramework::write_message_escaped(const char *s, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    // Copy runs of characters that need no escaping in one go.
+    const char *run = s;
+    const char *const end = s + len;
+    for (const char *p = s; p < end; ++p)
     {
-        if (c == '"')
-            m_msg_buf.append("\\\"");
-        else if (c == '\\')
-            m_msg_buf.append("\\\\");
-        else if (c < 0x20)
+        const unsigned char c = *p;
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        m_msg_buf.append(run, p - run);
+        run = p + 1;
+        if (c == '"' || c == '\\')
         {
-            char buf[7];
-            snprintf(buf, sizeof(buf), "\\u%04x", c);
-            m_msg_buf.append(buf);
+            m_msg_buf.push_back('\\');
+            m_msg_buf.push_back(c);
         }
         else
-            m_msg_buf.push_back(c);
+        {
+            const char esc[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            m_msg_buf.append(esc, sizeof(esc));
+        }
+    }
+    m_msg_buf.append(run, end - run);
+}
+
+void TilesFramework::_write_int(int value)
+{
+    char buf[12];
+    char *const end = buf + sizeof(buf);
+    char *p = end;
+    // Negate as unsigned, so that INT_MIN survives.
+    unsigned int u = value < 0 ? 0U - (unsigned int) value : value;
+    do
+    {
+        *--p = '0' + u % 10;
+        u /= 10;
     }
+    while (u);
+    if (value < 0)
+        *--p = '-';
+    m_msg_buf.append(p, end - p);
 }
 
-void TilesFramework::json_open(const string& name, char opener, char type)
+void TilesFramework::json_open(const char *name, size_t name_len,
+                               char opener, char type)
 {
     m_json_stack.resize(m_json_stack.size() + 1);
     JsonFrame& fr = m_json_stack.back();
     fr.start = m_msg_buf.size();
 
     json_write_comma();
-    if (!name.empty())
-        json_write_name(name);
+    if (name_len)
+        _json_write_name(name, name_len);
 
-    m_msg_buf.append(1, opener);
+    m_msg_buf.push_back(opener);
 
     fr.prefix_end = m_msg_buf.size();
     fr.type = type;
@@ -2465,14 +2484,19 @@ void TilesFramework::json_close(bool erase_if_empty, char type)
     if (erase_if_empty && json_is_empty())
         m_msg_buf.resize(m_json_stack.back().start);
     else
-        m_msg_buf.append(1, type);
+        m_msg_buf.push_back(type);
 
     m_json_stack.pop_back();
 }
 
 void TilesFramework::json_open_object(const string& name)
 {
-    json_open(name, '{', '}');
+    json_open(name.data(), name.size(), '{', '}');
+}
+
+void TilesFramework::json_open_object(const char *name)
+{
+    json_open(name, strlen(name), '{', '}');
 }
 
 void TilesFramework::json_close_object(bool erase_if_empty)
@@ -2482,7 +2506,12 @@ void TilesFramework::json_close_object(bool erase_if_empty)
 
 void TilesFramework::json_open_array(const string& name)
 {
-    json_open(name, '[', ']');
+    json_open(name.data(), name.size(), '[', ']');
+}
+
+void TilesFramework::json_open_array(const char *name)
+{
+    json_open(name, strlen(name), '[', ']');
 }
 
 void TilesFramework::json_close_array(bool erase_if_empty)
@@ -2497,7 +2526,7 @@ void TilesFramework::json_write_comma()
     char last = m_msg_buf[m_msg_buf.size() - 1];
     if (last == '{' || last == '[' || last == ',' || last == ':')
         return;
-    write_message(",");
+    m_msg_buf.push_back(',');
 }
 
 void TilesFramework::json_write_icons(const set<tileidx_t> &icons)
@@ -2511,20 +2540,30 @@ void TilesFramework::json_write_icons(const set<tileidx_t> &icons)
     json_close_array();
 }
 
-void TilesFramework::json_write_name(const string& name)
+void TilesFramework::_json_write_name(const char *name, size_t len)
 {
     json_write_comma();
 
-    write_message("\"");
-    write_message_escaped(name);
-    write_message("\":");
+    m_msg_buf.push_back('"');
+    write_message_escaped(name, len);
+    m_msg_buf.append("\":", 2);
+}
+
+void TilesFramework::json_write_name(const string& name)
+{
+    _json_write_name(name.data(), name.size());
+}
+
+void TilesFramework::json_write_name(const char *name)
+{
+    _json_write_name(name, strlen(name));
 }
 
 void TilesFramework::json_write_int(int value)
 {
     json_write_comma();
 
-    write_message("%d", value);
+    _write_int(value);
 }
 
 void TilesFramework::json_write_int(const string& name, int value)
@@ -2535,14 +2574,22 @@ void TilesFramework::json_write_int(const string& name, int value)
     json_write_int(value);
 }
 
+void TilesFramework::json_write_int(const char *name, int value)
+{
+    if (*name)
+        json_write_name(name);
+
+    json_write_int(value);
+}
+
 void TilesFramework::json_write_bool(bool value)
 {
     json_write_comma();
 
     if (value)
-        write_message("true");
+        m_msg_buf.append("true", 4);
     else
-        write_message("false");
+        m_msg_buf.append("false", 5);
 }
 
 void TilesFramework::json_write_bool(const string& name, bool value)
@@ -2553,11 +2600,19 @@ void TilesFramework::json_write_bool(const string& name, bool value)
     json_write_bool(value);
 }
 
+void TilesFramework::json_write_bool(const char *name, bool value)
+{
+    if (*name)
+        json_write_name(name);
+
+    json_write_bool(value);
+}
+
 void TilesFramework::json_write_null()
 {
     json_write_comma();
 
-    write_message("null");
+    m_msg_buf.append("null", 4);
 }
 
 void TilesFramework::json_write_null(const string& name)
@@ -2568,13 +2623,21 @@ void TilesFramework::json_write_null(const string& name)
     json_write_null();
 }
 
+void TilesFramework::json_write_null(const char *name)
+{
+    if (*name)
+        json_write_name(name);
+
+    json_write_null();
+}
+
 void TilesFramework::json_write_string(const string& value)
 {
     json_write_comma();
 
-    write_message("\"");
+    m_msg_buf.push_back('"');
     write_message_escaped(value);
-    write_message("\"");
+    m_msg_buf.push_back('"');
 }
 
 void TilesFramework::json_write_string(const string& name, const string& value)
@@ -2585,6 +2648,14 @@ void TilesFramework::json_write_string(const string& name, const string& value)
     json_write_string(value);
 }
 
+void TilesFramework::json_write_string(const char *name, const string& value)
+{
+    if (*name)
+        json_write_name(name);
+
+    json_write_string(value);
+}
+
 bool is_tiles()
 {
     return tiles.is_controlled_from_web();
@@ -8,6 +8,7 @@
 #ifdef USE_TILE_WEB
 
 #include <bitset>
+#include <cstdarg>
 #include <map>
 #include <vector>
 
@@ -21,6 +22,7 @@
 #include "text-tag-type.h"
 #include "tiledoll.h"
 #include "tilemcache.h"
+#include "tileweb-queue.h"
 #include "tileweb-text.h"
 #include "viewgeom.h"
 
@@ -156,7 +158,7 @@ public:
     void send_message(PRINTF(1, ));
     void flush_messages();
 
-    bool has_receivers() { return !m_dest_addrs.empty(); }
+    bool has_receivers() { return m_output.has_destinations(); }
     bool is_controlled_from_web() { return m_controlled_from_web; }
 
     /* Webtiles can receive input both via stdin, and on the
@@ -178,22 +180,32 @@ public:
 
     void check_for_control_messages();
 
-    // Helper functions for writing JSON
+    // Helper functions for writing JSON. These append straight to the
+    // message buffer without going through printf; the const char* overloads
+    // spare literal names a trip through std::string.
     void write_message_escaped(const string& s);
+    void write_message_escaped(const char *s, size_t len);
     void json_open_object(const string& name = "");
+    void json_open_object(const char *name);
     void json_close_object(bool erase_if_empty = false);
     void json_open_array(const string& name = "");
+    void json_open_array(const char *name);
     void json_close_array(bool erase_if_empty = false);
     void json_write_comma();
     void json_write_name(const string& name);
+    void json_write_name(const char *name);
     void json_write_int(int value);
     void json_write_int(const string& name, int value);
+    void json_write_int(const char *name, int value);
     void json_write_bool(bool value);
     void json_write_bool(const string& name, bool value);
+    void json_write_bool(const char *name, bool value);
     void json_write_null();
     void json_write_null(const string& name);
+    void json_write_null(const char *name);
     void json_write_string(const string& value);
     void json_write_string(const string& name, const string& value);
+    void json_write_string(const char *name, const string& value);
     void json_write_icons(const set<tileidx_t> &icons);
     /* Causes the current object/array to be erased if it is closed
        with erase_if_empty without writing any other content after
@@ -204,6 +216,9 @@ public:
 
     string m_sock_name;
     bool m_await_connection;
+    // Outbound messages; its policy and capacity may be set before
+    // initialise().
+    WebOutputQueue m_output;
 
     void set_text_cursor(bool enabled);
     void set_ui_state(WebtilesUIState state);
@@ -226,7 +241,6 @@ protected:
     int m_sock;
     int m_max_msg_size;
     string m_msg_buf;
-    vector<sockaddr_un> m_dest_addrs;
 
     bool m_controlled_from_web;
     bool m_need_flush;
@@ -245,8 +259,11 @@ protected:
     };
     vector<JsonFrame> m_json_stack;
 
-    void json_open(const string& name, char opener, char type);
+    void json_open(const char *name, size_t name_len, char opener, char type);
     void json_close(bool erase_if_empty, char type);
+    void _json_write_name(const char *name, size_t len);
+    void _write_int(int value);
+    void _vwrite_message(const char *format, va_list argp);
 
     struct UIStackFrame
     {
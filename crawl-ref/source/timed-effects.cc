@@ -866,7 +866,10 @@ void timeout_malign_gateways(int duration)
             {
                 // The marker hangs around until later.
                 if (env.grid(mmark->pos) == DNGN_MALIGN_GATEWAY)
+                {
                     env.grid(mmark->pos) = DNGN_FLOOR;
+                    set_terrain_changed(mmark->pos);
+                }
 
                 env.markers.remove(mmark);
             }
@@ -20,6 +20,7 @@
 #include "tile-env.h"
 #include "files.h"
 #include "libutil.h"
+#include "los.h"
 #include "maps.h"
 #include "message.h"
 #include "place.h"
@@ -709,6 +710,8 @@ static void _debug_destroy_doors()
             if (feat_is_closed_door(feat))
                 env.grid[x][y] = DNGN_FLOOR;
         }
+    // The doors are gone from the cached opacity plane too.
+    los_changed();
 }
 
 // Turns off greedy explore, then:
@@ -151,7 +151,7 @@ static void _do_wizard_command(int wiz_command)
     case CONTROL('T'): debug_terp_dlua(); break;
 
     case 'u': wizard_level_travel(false); break;
-    // case 'U': break;
+    case 'U': debug_lua_profile(); break;
     case CONTROL('U'): debug_terp_dlua(clua); break;
 
     case 'v': wizard_recharge_evokers(); break;
@@ -521,6 +521,7 @@ int list_wizard_commands(bool do_redraw_screen)
                        "<w>O</w>      measure exploration time\n"
                        "<w>Ctrl-T</w> dungeon (D)Lua interpreter\n"
                        "<w>Ctrl-U</w> client (C)Lua interpreter\n"
+                       "<w>U</w>      user Lua CPU time by function\n"
                        "<w>Ctrl-X</w> Xom effect stats\n"
 #ifdef DEBUG_DIAGNOSTICS
                        "<w>Ctrl-Q</w> make some debug messages quiet\n"